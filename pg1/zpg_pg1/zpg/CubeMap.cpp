@@ -107,82 +107,162 @@
 
 
 
-Color4 CubeMap::GetTexel(Vector3 & direction)
+int CubeMap::DirectionToFace(const Vector3 & direction, float & u, float & v)
 {
-	Color4 retval = Color4(50, 50, 50, 50);
-
-	int dIndex = direction.LargestComponent(true);
-	float u = 0;
-	float v = 0;
+	int dIndex = const_cast<Vector3 &>(direction).LargestComponent(true);
 
 	switch (dIndex)
 	{
 	case 0:					//Osa X
-		if (direction.x > 0)			//  POS X
-		{
-			const float tmp = 1.0f / abs(direction.x);
-			u = (direction.y * tmp + 1) * 0.5f;
-			v = ((direction.z * tmp + 1) * 0.5f);
+	{
+		const float tmp = 1.0f / abs(direction.x);
+		u = (direction.y * tmp + 1) * 0.5f;
+		v = (direction.z * tmp + 1) * 0.5f;
 
-			retval = (_maps[0])->get_texel(1 - u, v);
-		}
-		else							// NEG X
+		if (direction.x > 0)			//  POS X
 		{
-			const float tmp = 1.0f / abs(direction.x);
-			u = (direction.y * tmp + 1) * 0.5f;
-			v = (direction.z * tmp + 1) * 0.5f;
-			retval = (_maps[3])->get_texel(u, v);
+			u = 1 - u;
+			return 0;
 		}
-		break;
+
+		return 3;						// NEG X
+	}
 	case 1:					//Osa Y
+	{
+		const float tmp = 1.0f / abs(direction.y);
+		u = (direction.x * tmp + 1) * 0.5f;
+		v = (direction.z * tmp + 1) * 0.5f;
+
 		if (direction.y > 0)			//  POS Y
 		{
-			const float tmp = 1.0f / abs(direction.y);
-			u = (direction.x * tmp + 1) * 0.5f;
-			v = (direction.z * tmp + 1) * 0.5f;
+			return 1;
+		}
 
-			retval = _maps[1]->get_texel(u, v);
+		u = 1 - u;						// NEG Y
+		return 4;
+	}
+	default:				//Osa Z
+	{
+		const float tmp = 1.0f / abs(direction.z);
+		u = (direction.x * tmp + 1) * 0.5f;
+		v = (direction.y * tmp + 1) * 0.5f;
 
-		}
-		else							// NEG Y
+		if (direction.z > 0)			//  POS Z
 		{
-			const float tmp = 1.0f / abs(direction.y);
-			u = (direction.x * tmp + 1) * 0.5f;
-			v = (direction.z * tmp + 1) * 0.5f;
-			retval = (_maps[4])->get_texel(1 - u, v);
+			v = 1 - v;
+			return 2;
 		}
-		break;
-	case 2:					//Osa Z
-		if (direction.z > 0)			//  POS Z
+
+		return 5;						// NEG Z
+	}
+	}
+}
+
+Vector3 CubeMap::FaceToDirection(const int face, const float u, const float v)
+{
+	const float s = 2 * u - 1;
+	const float t = 2 * v - 1;
+
+	switch (face)
+	{
+	case 0: return Vector3(1, -s, t);	//  POS X
+	case 1: return Vector3(s, 1, t);	//  POS Y
+	case 2: return Vector3(s, -t, 1);	//  POS Z
+	case 3: return Vector3(-1, s, t);	// NEG X
+	case 4: return Vector3(-s, -1, t);	// NEG Y
+	default: return Vector3(s, t, -1);	// NEG Z
+	}
+}
+
+Color4 CubeMap::GetTexel(Vector3 & direction)
+{
+	float u = 0;
+	float v = 0;
+
+	const int face = DirectionToFace(direction, u, v);
+
+	return _maps[face]->get_texel(u, v);
+}
+
+// get_texel ma stred texelu x v u = x / width; texel urovne L pokryva 2^L texelu urovne 0 a jeho stred
+// je proti nim posunuty o 0.5 / width_L - 0.5 / width_0, na urovni 0 je tedy cteni stejne jako GetTexel
+static Color4 GetMipTexel(Texture * texture, Texture * base, const float u, const float v)
+{
+	const float du = 0.5f / texture->width() - 0.5f / base->width();
+	const float dv = 0.5f / texture->height() - 0.5f / base->height();
+
+	return texture->get_texel(u - du, v - dv);
+}
+
+Color4 CubeMap::GetTexel(Vector3 & direction, const float lod)
+{
+	float u = 0;
+	float v = 0;
+
+	const int face = DirectionToFace(direction, u, v);
+	const float level = MAX(0.0f, MIN(lod, static_cast<float>(_levels - 1)));
+	const int level0 = static_cast<int>(level);
+
+	if (level0 == _levels - 1)
+	{
+		return GetMipTexel(_mips[face][level0], _maps[face], u, v);
+	}
+
+	const float t = level - level0;
+
+	return GetMipTexel(_mips[face][level0], _maps[face], u, v) * (1 - t) + GetMipTexel(_mips[face][level0 + 1], _maps[face], u, v) * t;
+}
+
+int CubeMap::BuildMipmaps()
+{
+	for (int i = 0; i < CUBEMAP_FACES; i++)
+	{
+		if (_maps[i] == NULL)
 		{
-			const float tmp = 1.0f / abs(direction.z);
-			u = (direction.x * tmp + 1) * 0.5f;
-			v = (direction.y * tmp + 1) * 0.5f;
-			retval = (_maps[2])->get_texel(u, 1 - v);
+			return _levels;
 		}
-		else							// NEG Z
+	}
+
+	int levels = 1;
+
+	for (int size = MIN(_maps[0]->width(), _maps[0]->height()); size > 1 && levels < CUBEMAP_MAX_LEVELS; size /= 2)
+	{
+		levels++;
+	}
+
+#pragma omp parallel for
+	for (int i = 0; i < CUBEMAP_FACES; i++)
+	{
+		for (int level = _levels; level < levels; level++)
 		{
-			const float tmp = 1.0f / abs(direction.z);
-			u = (direction.x * tmp + 1) * 0.5f;
-			v = (direction.y * tmp + 1) * 0.5f;
-			retval = (_maps[5])->get_texel(u, v);
+			_ownedMips[i][level] = std::shared_ptr<Texture>(_mips[i][level - 1]->Downsample());
+			_mips[i][level] = _ownedMips[i][level].get();
 		}
-		break;
 	}
 
+	_levels = levels;
+
+	return _levels;
+}
 
+static const char * face_names[CUBEMAP_FACES] = { "posx", "posy", "posz", "negx", "negy", "negz" };
 
-	return retval;
+std::string CubeMap::GetFaceFileName(const int face) const
+{
+	return _path + "/" + face_names[face] + ".jpg";
 }
 
 CubeMap::CubeMap(std::string path)
 {
-	this->_maps[0] = LoadTexture((path + "/posx.jpg").c_str());
-	this->_maps[1] = LoadTexture((path + "/posy.jpg").c_str());
-	this->_maps[2] = LoadTexture((path + "/posz.jpg").c_str());
-	this->_maps[3] = LoadTexture((path + "/negx.jpg").c_str());
-	this->_maps[4] = LoadTexture((path + "/negy.jpg").c_str());
-	this->_maps[5] = LoadTexture((path + "/negz.jpg").c_str());
+	this->_path = path;
+
+	for (int i = 0; i < CUBEMAP_FACES; i++)
+	{
+		this->_maps[i] = LoadTexture(GetFaceFileName(i).c_str());
+		this->_mips[i][0] = this->_maps[i];
+	}
+
+	this->_levels = 1;
 
 
 }
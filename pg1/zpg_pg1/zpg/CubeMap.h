@@ -1,13 +1,39 @@
 #pragma once
+
+#define CUBEMAP_FACES 6 // posx, posy, posz, negx, negy, negz
+#define CUBEMAP_MAX_LEVELS 16 // maximalni pocet urovni mip pyramidy
+
 class CubeMap
 {
 private:
 	Texture *_maps[6];
+	Texture *_mips[6][CUBEMAP_MAX_LEVELS]; // _mips[i][0] == _maps[i]
+	// vlastnictvi zmensenych urovni, CubeMap se predava hodnotou, posledni kopie je uvolni
+	std::shared_ptr<Texture> _ownedMips[6][CUBEMAP_MAX_LEVELS];
+	int _levels;
+	std::string _path;
 public:
 	
 
 	CubeMap(std::string path);
 	Color4 GetTexel(Vector3 & direction);
+	// trilinearni cteni z mip pyramidy, lod 0 = plne rozliseni, bez BuildMipmaps jen uroven 0
+	Color4 GetTexel(Vector3 & direction, const float lod);
+
+	// postavi mip pyramidu vsech sten (paralelne), vraci pocet urovni
+	int BuildMipmaps();
+	int GetNoLevels() const { return _levels; }
+	// sirka steny na urovni 0 v texelech
+	int GetFaceSize() const { return (_maps[0] != NULL) ? _maps[0]->width() : 0; }
+
+	// stena zasazena smerem a texturove souradnice (u, v) na ni, stejne jako v GetTexel
+	static int DirectionToFace(const Vector3 & direction, float & u, float & v);
+	// inverze DirectionToFace, vraci nenormalizovany smer
+	static Vector3 FaceToDirection(const int face, const float u, const float v);
+
+	Texture * GetFace(const int face) { return _maps[face]; }
+	std::string GetPath() const { return _path; }
+	std::string GetFaceFileName(const int face) const;
 	//~CubeMap();
 };
 
@@ -134,6 +134,64 @@ Ray Camera::GenerateRay( const float sx, const float sy ) const
 	return Ray( view_from_, direction, 0 );
 }
 
+void Camera::GenerateRayPacket( const int x, const int y, RTCRayN * packet, const int n ) const
+{
+	assert( ( n == 4 ) || ( n == 8 ) || ( n == 16 ) );
+
+	const float * m = view_t_.data();
+
+	// x-ove souradnice ctverice pixelu jsou pro vsechny radky bloku stejne
+	const __m128 sx = _mm_add_ps( _mm_set1_ps( static_cast<float>( x ) ), _mm_set_ps( 3, 2, 1, 0 ) );
+	const __m128 ex = _mm_mul_ps( _mm_set1_ps( pixel_size_ ), _mm_sub_ps( sx, _mm_set1_ps( 0.5f * ( width_ - 1 ) ) ) );
+	const __m128 ez = _mm_set1_ps( -d_ );
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	for ( int row = 0; row < n / 4; ++row )
+	{
+		const __m128 ey = _mm_set1_ps( pixel_size_ * ( -( y + row ) + 0.5f * ( height_ - 1 ) ) );
+
+		// normalizace smeru v kamerovem prostoru
+		__m128 rn = _mm_div_ps( one, _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( ex, ex ),
+			_mm_mul_ps( ey, ey ) ), _mm_mul_ps( ez, ez ) ) ) );
+		const __m128 cx = _mm_mul_ps( ex, rn );
+		const __m128 cy = _mm_mul_ps( ey, rn );
+		const __m128 cz = _mm_mul_ps( ez, rn );
+
+		// prechod do svetoveho souradneho systemu (pouze rotace view_t_)
+		__m128 dx = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( m[0] ), cx ),
+			_mm_mul_ps( _mm_set1_ps( m[1] ), cy ) ), _mm_mul_ps( _mm_set1_ps( m[2] ), cz ) );
+		__m128 dy = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( m[4] ), cx ),
+			_mm_mul_ps( _mm_set1_ps( m[5] ), cy ) ), _mm_mul_ps( _mm_set1_ps( m[6] ), cz ) );
+		__m128 dz = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( m[8] ), cx ),
+			_mm_mul_ps( _mm_set1_ps( m[9] ), cy ) ), _mm_mul_ps( _mm_set1_ps( m[10] ), cz ) );
+
+		rn = _mm_div_ps( one, _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ),
+			_mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) ) ) );
+		dx = _mm_mul_ps( dx, rn );
+		dy = _mm_mul_ps( dy, rn );
+		dz = _mm_mul_ps( dz, rn );
+
+		const int i = 4 * row; // prvni paprsek radku, adresy jsou zarovnane na 16 bytu
+
+		_mm_store_ps( &RTCRayN_org_x( packet, n, i ), _mm_set1_ps( view_from_.x ) );
+		_mm_store_ps( &RTCRayN_org_y( packet, n, i ), _mm_set1_ps( view_from_.y ) );
+		_mm_store_ps( &RTCRayN_org_z( packet, n, i ), _mm_set1_ps( view_from_.z ) );
+
+		_mm_store_ps( &RTCRayN_dir_x( packet, n, i ), dx );
+		_mm_store_ps( &RTCRayN_dir_y( packet, n, i ), dy );
+		_mm_store_ps( &RTCRayN_dir_z( packet, n, i ), dz );
+
+		_mm_store_ps( &RTCRayN_tnear( packet, n, i ), _mm_setzero_ps() );
+		_mm_store_ps( &RTCRayN_tfar( packet, n, i ), _mm_set1_ps( FLT_MAX ) );
+		_mm_store_ps( &RTCRayN_time( packet, n, i ), _mm_setzero_ps() );
+
+		_mm_store_si128( reinterpret_cast<__m128i *>( &RTCRayN_mask( packet, n, i ) ), _mm_set1_epi32( -1 ) );
+		_mm_store_si128( reinterpret_cast<__m128i *>( &RTCRayN_geomID( packet, n, i ) ), _mm_set1_epi32( RTC_INVALID_GEOMETRY_ID ) );
+		_mm_store_si128( reinterpret_cast<__m128i *>( &RTCRayN_primID( packet, n, i ) ), _mm_set1_epi32( RTC_INVALID_GEOMETRY_ID ) );
+		_mm_store_si128( reinterpret_cast<__m128i *>( &RTCRayN_instID( packet, n, i ) ), _mm_set1_epi32( RTC_INVALID_GEOMETRY_ID ) );
+	}
+}
+
 void Camera::Save( const char * file_name )
 {
 	FILE * file = fopen( file_name, "a" );
@@ -36,6 +36,17 @@ public:
 
 	Ray GenerateRay( const float sx, const float sy ) const;	
 
+	//! Vygeneruje paket primarnich paprsku pro blok 4 px siroky a n / 4 px vysoky.
+	/*!
+	Paprsky jsou v SoA layoutu RTCRay4/8/16, po radcich bloku, smery se pocitaji pomoci SSE po ctverici.
+
+	\param x levy okraj bloku [px].
+	\param y horni okraj bloku [px].
+	\param packet paket paprsku velikosti \a n.
+	\param n velikost paketu (4, 8 nebo 16).
+	*/
+	void GenerateRayPacket( const int x, const int y, RTCRayN * packet, const int n ) const;
+
 	float orthogonal_depth( const Vector3 & p ) const;
 	Vector3 ws2es( const Vector3 & p ) const;
 	Vector3 normal_ws2es( const Vector3 & p ) const;
@@ -0,0 +1,155 @@
+#include "stdafx.h"
+
+void FeatureBuffers::Create( const int width, const int height )
+{
+	albedo = cv::Mat::zeros( height, width, CV_32FC3 );
+	normal = cv::Mat::zeros( height, width, CV_32FC3 );
+	depth = cv::Mat::zeros( height, width, CV_32FC1 );
+	id = cv::Mat( height, width, CV_32SC1, cv::Scalar( -1 ) );
+}
+
+void FeatureBuffers::Store( const int x, const int y, const int geom_id, const Vector3 & albedo, const Vector3 & normal, const float depth )
+{
+	this->albedo.at<cv::Vec3f>( y, x ) = cv::Vec3f( albedo.z, albedo.y, albedo.x );
+	this->normal.at<cv::Vec3f>( y, x ) = cv::Vec3f( normal.x, normal.y, normal.z );
+	this->depth.at<float>( y, x ) = depth;
+	this->id.at<int>( y, x ) = geom_id;
+}
+
+Denoiser::Denoiser( const int iterations, const float sigma_color, const float sigma_normal, const float sigma_depth )
+{
+	iterations_ = MAX( 1, iterations );
+	sigma_color_ = sigma_color;
+	sigma_normal_ = sigma_normal;
+	sigma_depth_ = sigma_depth;
+}
+
+int Denoiser::iterations() const
+{
+	return iterations_;
+}
+
+// albedo blizke nule by pri deleni zesililo sum, takove kanaly se nedemoduluji
+static inline float SafeAlbedo( const float a )
+{
+	return ( a > 1e-3f ) ? a : 1.0f;
+}
+
+int Denoiser::Filter( const cv::Mat & color, const FeatureBuffers & features, cv::Mat & result ) const
+{
+	if ( color.type() != CV_32FC3 || color.size() != features.albedo.size() || color.size() != features.normal.size() ||
+		color.size() != features.depth.size() || color.size() != features.id.size() )
+	{
+		printf( "Denoiser buffers do not match the image, image left unfiltered.\n" );
+
+		return -1;
+	}
+
+	cv::Mat src( color.size(), CV_32FC3 );
+	cv::Mat dst( color.size(), CV_32FC3 );
+
+#pragma omp parallel for schedule( dynamic, 4 )
+	for ( int y = 0; y < color.rows; ++y )
+	{
+		for ( int x = 0; x < color.cols; ++x )
+		{
+			const cv::Vec3f & c = color.at<cv::Vec3f>( y, x );
+			const cv::Vec3f & a = features.albedo.at<cv::Vec3f>( y, x );
+
+			src.at<cv::Vec3f>( y, x ) = cv::Vec3f( c[0] / SafeAlbedo( a[0] ), c[1] / SafeAlbedo( a[1] ), c[2] / SafeAlbedo( a[2] ) );
+		}
+	}
+
+	float sigma_color = sigma_color_;
+
+	for ( int i = 0; i < iterations_; ++i )
+	{
+		Iterate( src, features, 1 << i, sigma_color, dst );
+		cv::swap( src, dst );
+
+		sigma_color *= 0.5f; // jemnejsi urovne uz sum odstranily, hrube maji chranit detaily
+	}
+
+	result.create( color.size(), CV_32FC3 );
+
+#pragma omp parallel for schedule( dynamic, 4 )
+	for ( int y = 0; y < color.rows; ++y )
+	{
+		for ( int x = 0; x < color.cols; ++x )
+		{
+			const cv::Vec3f & c = src.at<cv::Vec3f>( y, x );
+			const cv::Vec3f & a = features.albedo.at<cv::Vec3f>( y, x );
+
+			result.at<cv::Vec3f>( y, x ) = cv::Vec3f( c[0] * SafeAlbedo( a[0] ), c[1] * SafeAlbedo( a[1] ), c[2] * SafeAlbedo( a[2] ) );
+		}
+	}
+
+	return 0;
+}
+
+void Denoiser::Iterate( const cv::Mat & src, const FeatureBuffers & features, const int step, const float sigma_color, cv::Mat & dst ) const
+{
+	static const float kernel[5] = { 1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16 };
+
+	const float inv_color = 1.0f / MAX( SQR( sigma_color ), 1e-8f );
+	const float inv_normal = 1.0f / SQR( sigma_normal_ );
+	const float inv_depth = 1.0f / SQR( sigma_depth_ );
+
+#pragma omp parallel for schedule( dynamic, 4 )
+	for ( int y = 0; y < src.rows; ++y )
+	{
+		for ( int x = 0; x < src.cols; ++x )
+		{
+			const cv::Vec3f & cp = src.at<cv::Vec3f>( y, x );
+			const int id = features.id.at<int>( y, x );
+
+			if ( id < 0 )
+			{
+				dst.at<cv::Vec3f>( y, x ) = cp; // pozadi se nefiltruje
+				continue;
+			}
+
+			const cv::Vec3f & np = features.normal.at<cv::Vec3f>( y, x );
+			const float zp = features.depth.at<float>( y, x );
+
+			cv::Vec3f sum( 0, 0, 0 );
+			float weights = 0;
+
+			for ( int j = -2; j <= 2; ++j )
+			{
+				const int qy = y + j * step;
+
+				if ( qy < 0 || qy >= src.rows )
+				{
+					continue;
+				}
+
+				for ( int i = -2; i <= 2; ++i )
+				{
+					const int qx = x + i * step;
+
+					if ( qx < 0 || qx >= src.cols || features.id.at<int>( qy, qx ) != id )
+					{
+						continue;
+					}
+
+					const cv::Vec3f & cq = src.at<cv::Vec3f>( qy, qx );
+					const cv::Vec3f & nq = features.normal.at<cv::Vec3f>( qy, qx );
+					const float zq = features.depth.at<float>( qy, qx );
+
+					const cv::Vec3f dc = cp - cq;
+					const cv::Vec3f dn = np - nq;
+					const float dz = ( zp - zq ) / MAX( fabs( zp ), 1e-6f );
+
+					const float w = kernel[i + 2] * kernel[j + 2] * exp( -( dc.dot( dc ) * inv_color + dn.dot( dn ) * inv_normal + SQR( dz ) * inv_depth ) );
+
+					sum += cq * w;
+					weights += w;
+				}
+			}
+
+			// stredovy pixel ma vzdy kladnou vahu, weights > 0
+			dst.at<cv::Vec3f>( y, x ) = sum / weights;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef DENOISER_H_
+#define DENOISER_H_
+
+#define DENOISER_ITERATIONS 5 // pocet urovni a-trous, polomer posledni urovne je 2 * 2^4 px
+
+/*! \struct FeatureBuffers
+\brief Pomocne obrazy pro rizeni filtrace, plnene behem renderovani.
+*/
+struct FeatureBuffers
+{
+	cv::Mat albedo; /*!< Zakladni barva materialu zasahu (BGR, CV_32FC3). */
+	cv::Mat normal; /*!< Stinovaci normala zasahu (xyz, CV_32FC3). */
+	cv::Mat depth; /*!< Hloubka zasahu podel osy kamery [m] (CV_32FC1). */
+	cv::Mat id; /*!< geomID zasahu, -1 pri minuti (CV_32SC1). */
+
+	//! Alokuje buffery \a width x \a height a oznaci vsechny pixely jako minute.
+	void Create( const int width, const int height );
+
+	//! Ulozi vlastnosti pixelu (x, y).
+	void Store( const int x, const int y, const int geom_id, const Vector3 & albedo, const Vector3 & normal, const float depth );
+};
+
+/*! \class Denoiser
+\brief Hranove citlivy a-trous waveletovy filtr (Dammertz et al. 2010).
+
+Obraz se filtruje opakovane B3 splinem 5 x 5 s mezerami 1, 2, 4, ...
+pixelu, takze velky polomer stoji jen 25 vzorku na uroven. Vaha souseda je
+soucinem vah podle rozdilu barvy, normaly a relativni hloubky; pres hranici
+ruznych ploch (jine geomID) se vubec nefiltruje. Barva se pred filtraci
+vydeli albedem, aby textura materialu nerozmazala, a po ni se jim zase
+vynasobi. Kazda uroven bezi paralelne po radcich.
+*/
+class Denoiser
+{
+public:
+	//! Obecny konstruktor.
+	/*!
+	\param iterations pocet urovni.
+	\param sigma_color citlivost na rozdil barvy, na kazde dalsi urovni se puli.
+	\param sigma_normal citlivost na rozdil normal.
+	\param sigma_depth citlivost na relativni rozdil hloubky.
+	*/
+	Denoiser( const int iterations = DENOISER_ITERATIONS, const float sigma_color = 0.5f,
+		const float sigma_normal = 0.3f, const float sigma_depth = 0.05f );
+
+	//! Vyfiltruje obraz \a color (CV_32FC3) rizeny \a features do \a result.
+	/*!
+	\return 0 pri uspechu, -1 pokud rozmery bufferu nesouhlasi.
+	*/
+	int Filter( const cv::Mat & color, const FeatureBuffers & features, cv::Mat & result ) const;
+
+	int iterations() const;
+
+private:
+	//! Jedna uroven filtru s mezerou \a step pixelu.
+	void Iterate( const cv::Mat & src, const FeatureBuffers & features, const int step, const float sigma_color, cv::Mat & dst ) const;
+
+	int iterations_; /*!< Pocet urovni. */
+	float sigma_color_; /*!< Citlivost na barvu. */
+	float sigma_normal_; /*!< Citlivost na normalu. */
+	float sigma_depth_; /*!< Citlivost na relativni hloubku. */
+};
+
+#endif
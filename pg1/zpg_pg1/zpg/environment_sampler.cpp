@@ -0,0 +1,213 @@
+#include "stdafx.h"
+
+int AliasTable::Build( const std::vector<float> & weights )
+{
+	const int n = static_cast<int>( weights.size() );
+
+	double sum = 0;
+
+	for ( int i = 0; i < n; ++i )
+	{
+		sum += weights[i];
+	}
+
+	if ( !( sum > 0 ) )
+	{
+		return -1;
+	}
+
+	threshold_.resize( n );
+	alias_.resize( n );
+	probability_.resize( n );
+
+	// Voseho algoritmus, bunky pod a nad prumerem se paruji
+	std::vector<int> small;
+	std::vector<int> large;
+	std::vector<double> scaled( n );
+
+	for ( int i = 0; i < n; ++i )
+	{
+		probability_[i] = static_cast<float>( weights[i] / sum );
+		scaled[i] = weights[i] * n / sum;
+		alias_[i] = i;
+
+		if ( scaled[i] < 1 )
+		{
+			small.push_back( i );
+		}
+		else
+		{
+			large.push_back( i );
+		}
+	}
+
+	while ( !small.empty() && !large.empty() )
+	{
+		const int s = small.back();
+		small.pop_back();
+		const int l = large.back();
+
+		threshold_[s] = static_cast<float>( scaled[s] );
+		alias_[s] = l;
+
+		scaled[l] -= 1 - scaled[s];
+
+		if ( scaled[l] < 1 )
+		{
+			large.pop_back();
+			small.push_back( l );
+		}
+	}
+
+	// zbytky jsou kvuli zaokrouhleni blizko 1
+	for ( size_t i = 0; i < small.size(); ++i )
+	{
+		threshold_[small[i]] = 1;
+	}
+
+	for ( size_t i = 0; i < large.size(); ++i )
+	{
+		threshold_[large[i]] = 1;
+	}
+
+	return 0;
+}
+
+int AliasTable::Sample( const float u ) const
+{
+	const int n = size();
+	const float x = u * n;
+	const int i = MIN( static_cast<int>( x ), n - 1 );
+
+	return ( x - i < threshold_[i] ) ? i : alias_[i];
+}
+
+float AliasTable::probability( const int i ) const
+{
+	return probability_[i];
+}
+
+int AliasTable::size() const
+{
+	return static_cast<int>( threshold_.size() );
+}
+
+EnvironmentSampler::EnvironmentSampler()
+{
+}
+
+// derivace prostoroveho uhlu podle (u, v) na stene, stena lezi v rovine ve vzdalenosti 1
+static float SolidAngleJacobian( const float u, const float v )
+{
+	const float a = 2 * u - 1;
+	const float b = 2 * v - 1;
+	const float r2 = 1 + SQR( a ) + SQR( b );
+
+	return 4.0f / ( r2 * sqrt( r2 ) );
+}
+
+int EnvironmentSampler::Build( CubeMap & cube_map )
+{
+	for ( int face = 0; face < CUBEMAP_FACES; ++face )
+	{
+		if ( cube_map.GetFace( face ) == NULL )
+		{
+			printf( "Cube map %s is incomplete, no environment sampling.\n", cube_map.GetPath().c_str() );
+
+			return -1;
+		}
+	}
+
+	const int n = ENV_SAMPLER_SIZE;
+	std::vector<float> face_weights( CUBEMAP_FACES );
+
+#pragma omp parallel for schedule( dynamic )
+	for ( int face = 0; face < CUBEMAP_FACES; ++face )
+	{
+		Texture * texture = cube_map.GetFace( face );
+
+		// kazdou bunku pokryjeme k x k body textury
+		const int k = MAX( 1, MIN( 8, texture->width() / n ) );
+		std::vector<float> weights( SQR( n ) );
+		double face_weight = 0;
+
+		for ( int cy = 0; cy < n; ++cy )
+		{
+			for ( int cx = 0; cx < n; ++cx )
+			{
+				float luminance = 0;
+
+				for ( int j = 0; j < k; ++j )
+				{
+					for ( int i = 0; i < k; ++i )
+					{
+						const Color4 texel = texture->get_texel( ( cx + ( i + 0.5f ) / k ) / n, ( cy + ( j + 0.5f ) / k ) / n );
+						luminance += 0.2126f * texel.r + 0.7152f * texel.g + 0.0722f * texel.b;
+					}
+				}
+
+				const float weight = luminance / SQR( k ) * SolidAngleJacobian( ( cx + 0.5f ) / n, ( cy + 0.5f ) / n ) / SQR( n );
+
+				weights[cy * n + cx] = weight;
+				face_weight += weight;
+			}
+		}
+
+		// cerna stena se nikdy nevybere, jeji tabulka ale musi existovat
+		if ( cells_[face].Build( weights ) != 0 )
+		{
+			std::fill( weights.begin(), weights.end(), 1.0f );
+			cells_[face].Build( weights );
+		}
+
+		face_weights[face] = static_cast<float>( face_weight );
+	}
+
+	const int status = faces_.Build( face_weights );
+
+	if ( status != 0 )
+	{
+		printf( "Cube map %s is black, no environment sampling.\n", cube_map.GetPath().c_str() );
+	}
+
+	return status;
+}
+
+float EnvironmentSampler::Pdf( const int face, const int cell, const float u, const float v ) const
+{
+	// P(stena) P(bunka) / plocha bunky v (u, v) / Jacobian
+	return faces_.probability( face ) * cells_[face].probability( cell ) *
+		SQR( ENV_SAMPLER_SIZE ) / SolidAngleJacobian( u, v );
+}
+
+Vector3 EnvironmentSampler::Sample( Sampler & sampler, float & pdf ) const
+{
+	const int n = ENV_SAMPLER_SIZE;
+
+	const int face = faces_.Sample( sampler.Next1D() );
+	const int cell = cells_[face].Sample( sampler.Next1D() );
+
+	const float u = ( cell % n + sampler.Next1D() ) / n;
+	const float v = ( cell / n + sampler.Next1D() ) / n;
+
+	pdf = Pdf( face, cell, u, v );
+
+	Vector3 direction = CubeMap::FaceToDirection( face, u, v );
+	direction.Normalize();
+
+	return direction;
+}
+
+float EnvironmentSampler::Pdf( const Vector3 & direction ) const
+{
+	const int n = ENV_SAMPLER_SIZE;
+
+	float u = 0;
+	float v = 0;
+
+	const int face = CubeMap::DirectionToFace( direction, u, v );
+	const int cx = MAX( 0, MIN( n - 1, static_cast<int>( u * n ) ) );
+	const int cy = MAX( 0, MIN( n - 1, static_cast<int>( v * n ) ) );
+
+	return Pdf( face, cy * n + cx, u, v );
+}
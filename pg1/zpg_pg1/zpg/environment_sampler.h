@@ -0,0 +1,77 @@
+#ifndef ENVIRONMENT_SAMPLER_H_
+#define ENVIRONMENT_SAMPLER_H_
+
+#define ENV_SAMPLER_SIZE 128 // rozliseni mrizky bunek na jedne stene cube mapy
+
+/*! \class AliasTable
+\brief Diskretni rozdeleni s vyberem v case O(1) (Walker, Vose).
+
+Kazda ze stejne pravdepodobnych bunek obsahuje pravdepodobnost prijeti
+a nahradni index, vyber tedy stoji jedno nahodne cislo a jedno porovnani.
+*/
+class AliasTable
+{
+public:
+	//! Sestavi tabulku z nezapornych vah \a weights, nemusi byt normalizovane.
+	/*!
+	\return 0 pri uspechu, -1 pokud je soucet vah nulovy.
+	*/
+	int Build( const std::vector<float> & weights );
+
+	//! Vybere index podle rozdeleni, \a u z intervalu <0, 1).
+	int Sample( const float u ) const;
+
+	//! Pravdepodobnost indexu \a i.
+	float probability( const int i ) const;
+
+	//! Pocet prvku.
+	int size() const;
+
+private:
+	std::vector<float> threshold_; /*!< Pravdepodobnost prijeti bunky. */
+	std::vector<int> alias_; /*!< Nahradni index bunky. */
+	std::vector<float> probability_; /*!< Normalizovane vahy. */
+};
+
+/*! \class EnvironmentSampler
+\brief Vzorkovani smeru cube mapy umerne jasu.
+
+Kazda stena se rozdeli na ENV_SAMPLER_SIZE x ENV_SAMPLER_SIZE bunek s vahou
+jas * prostorovy uhel. Stena se vybere tabulkou pres sest sten, bunka
+tabulkou dane steny a bod uvnitr bunky rovnomerne v (u, v). Hustota
+v prostorovem uhlu je pak konstantni v ramci bunky az na Jacobian
+projekce na stenu.
+*/
+class EnvironmentSampler
+{
+public:
+	//! Vychozi konstruktor.
+	EnvironmentSampler();
+
+	//! Sestavi tabulky z cube mapy.
+	/*!
+	\param cube_map zdrojova cube mapa.
+	\return 0 pri uspechu, -1 pokud cube mapa nema vsechny steny nebo je cerna.
+	*/
+	int Build( CubeMap & cube_map );
+
+	//! Vygeneruje jednotkovy smer, spotrebuje ctyri dimenze \a sampler.
+	/*!
+	\param sampler zdroj nahodnych cisel.
+	\param pdf hustota vraceneho smeru vzhledem k prostorovemu uhlu.
+	\return Smer k prostredi.
+	*/
+	Vector3 Sample( Sampler & sampler, float & pdf ) const;
+
+	//! Hustota smeru \a direction vzhledem k prostorovemu uhlu.
+	float Pdf( const Vector3 & direction ) const;
+
+private:
+	//! Hustota bunky \a cell na stene \a face v bode (u, v) stena.
+	float Pdf( const int face, const int cell, const float u, const float v ) const;
+
+	AliasTable faces_; /*!< Vyber steny. */
+	AliasTable cells_[CUBEMAP_FACES]; /*!< Vyber bunky na stene. */
+};
+
+#endif
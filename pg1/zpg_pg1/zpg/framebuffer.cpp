@@ -0,0 +1,216 @@
+#include "stdafx.h"
+
+Framebuffer::Framebuffer()
+{
+	width_ = 0;
+	height_ = 0;
+	tiles_across_ = 0;
+	tiles_down_ = 0;
+}
+
+void Framebuffer::Create( const int width, const int height )
+{
+	width_ = width;
+	height_ = height;
+	tiles_across_ = ( width + TILE_SIZE - 1 ) >> TILE_SHIFT;
+	tiles_down_ = ( height + TILE_SIZE - 1 ) >> TILE_SHIFT;
+
+	data_.assign( static_cast<size_t>( tiles_across_ ) * tiles_down_ * SQR( TILE_SIZE ) * 4, 0.0f );
+}
+
+void Framebuffer::Clear()
+{
+	std::fill( data_.begin(), data_.end(), 0.0f );
+}
+
+int Framebuffer::width() const
+{
+	return width_;
+}
+
+int Framebuffer::height() const
+{
+	return height_;
+}
+
+int Framebuffer::ParseTonemap( const char * name )
+{
+	if ( strcmp( name, "clamp" ) == 0 ) return TONEMAP_CLAMP;
+	if ( strcmp( name, "reinhard" ) == 0 ) return TONEMAP_REINHARD;
+	if ( strcmp( name, "aces" ) == 0 ) return TONEMAP_ACES;
+
+	return -1;
+}
+
+// (b, g, r, w) -> (b, g, r) / w, nulova vaha dava cernou
+static inline __m128 Normalize( const __m128 p )
+{
+	const __m128 w = _mm_shuffle_ps( p, p, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+	const __m128 valid = _mm_cmpgt_ps( w, _mm_setzero_ps() );
+
+	return _mm_and_ps( _mm_div_ps( p, w ), valid );
+}
+
+static inline __m128 ApplyTonemap( __m128 c, const Tonemap tonemap )
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	c = _mm_max_ps( c, zero );
+
+	switch ( tonemap )
+	{
+	case TONEMAP_REINHARD:
+		c = _mm_div_ps( c, _mm_add_ps( one, c ) );
+		break;
+
+	case TONEMAP_ACES:
+		// x (2.51 x + 0.03) / (x (2.43 x + 0.59) + 0.14)
+		c = _mm_div_ps( _mm_mul_ps( c, _mm_add_ps( _mm_mul_ps( c, _mm_set1_ps( 2.51f ) ), _mm_set1_ps( 0.03f ) ) ),
+			_mm_add_ps( _mm_mul_ps( c, _mm_add_ps( _mm_mul_ps( c, _mm_set1_ps( 2.43f ) ), _mm_set1_ps( 0.59f ) ) ), _mm_set1_ps( 0.14f ) ) );
+		break;
+
+	default:
+		break;
+	}
+
+	return _mm_min_ps( c, one );
+}
+
+// resolve n pixelu (b, g, r, w) do n * 3 bytu, ctyri pixely na jedno zabaleni
+static void ResolvePixels( const __m128 * pixels, const int n, const ResolveSettings & settings, unsigned char * dst )
+{
+	const __m128 scale = _mm_set1_ps( 255.0f * settings.exposure );
+	const __m128 exposure = _mm_set1_ps( settings.exposure );
+	const __m128 to_byte = _mm_set1_ps( 255.0f );
+
+	for ( int i = 0; i < n; i += 4 )
+	{
+		__m128i q[4];
+
+		for ( int j = 0; j < 4; ++j )
+		{
+			const __m128 p = ( i + j < n ) ? pixels[i + j] : _mm_setzero_ps();
+
+			// pri orezu staci jedno nasobeni, jinak expozice, operator a az pak 255
+			const __m128 c = ( settings.tonemap == TONEMAP_CLAMP ) ?
+				_mm_min_ps( _mm_max_ps( _mm_mul_ps( Normalize( p ), scale ), _mm_setzero_ps() ), to_byte ) :
+				_mm_mul_ps( ApplyTonemap( _mm_mul_ps( Normalize( p ), exposure ), settings.tonemap ), to_byte );
+
+			q[j] = _mm_cvtps_epi32( c ); // zaokrouhleni k nejblizsimu sudemu jako cvRound
+		}
+
+		RTCORE_ALIGN( 16 ) unsigned char bytes[16];
+		_mm_store_si128( reinterpret_cast<__m128i *>( bytes ), _mm_packus_epi16( _mm_packs_epi32( q[0], q[1] ), _mm_packs_epi32( q[2], q[3] ) ) );
+
+		for ( int j = 0; j < 4 && i + j < n; ++j )
+		{
+			dst[( i + j ) * 3] = bytes[j * 4];
+			dst[( i + j ) * 3 + 1] = bytes[j * 4 + 1];
+			dst[( i + j ) * 3 + 2] = bytes[j * 4 + 2];
+		}
+	}
+}
+
+void Framebuffer::ResolveSpan( const float * bgr, const int n, const ResolveSettings & settings, unsigned char * dst )
+{
+	RTCORE_ALIGN( 16 ) __m128 pixels[16];
+
+	// po kusech pevne delky, zarovnany buffer na zasobniku
+	for ( int i = 0; i < n; i += 16 )
+	{
+		const int m = MIN( 16, n - i );
+
+		for ( int x = 0; x < m; ++x )
+		{
+			const float * p = bgr + ( i + x ) * 3;
+			pixels[x] = _mm_setr_ps( p[0], p[1], p[2], 1.0f );
+		}
+
+		ResolvePixels( pixels, m, settings, dst + i * 3 );
+	}
+}
+
+void Framebuffer::ResolveFloat( cv::Mat & image ) const
+{
+	image.create( height_, width_, CV_32FC3 );
+
+#pragma omp parallel for schedule( dynamic )
+	for ( int t = 0; t < tiles_across_ * tiles_down_; ++t )
+	{
+		const int x0 = ( t % tiles_across_ ) << TILE_SHIFT;
+		const int y0 = ( t / tiles_across_ ) << TILE_SHIFT;
+		const int w = MIN( TILE_SIZE, width_ - x0 );
+		const int h = MIN( TILE_SIZE, height_ - y0 );
+
+		for ( int y = 0; y < h; ++y )
+		{
+			const float * src = &data_[offset( x0, y0 + y )];
+			float * dst = image.ptr<float>( y0 + y ) + x0 * 3;
+
+			for ( int x = 0; x < w; ++x )
+			{
+				RTCORE_ALIGN( 16 ) float c[4];
+				_mm_store_ps( c, Normalize( _mm_loadu_ps( src + x * 4 ) ) );
+
+				dst[x * 3] = c[0];
+				dst[x * 3 + 1] = c[1];
+				dst[x * 3 + 2] = c[2];
+			}
+		}
+	}
+}
+
+void Framebuffer::Resolve( cv::Mat & image, const ResolveSettings & settings, const bool parallel ) const
+{
+	image.create( height_, width_, CV_8UC3 );
+
+#pragma omp parallel for schedule( dynamic ) if ( parallel )
+	for ( int t = 0; t < tiles_across_ * tiles_down_; ++t )
+	{
+		const int x0 = ( t % tiles_across_ ) << TILE_SHIFT;
+		const int y0 = ( t / tiles_across_ ) << TILE_SHIFT;
+		const int w = MIN( TILE_SIZE, width_ - x0 );
+		const int h = MIN( TILE_SIZE, height_ - y0 );
+
+		__m128 pixels[TILE_SIZE];
+
+		for ( int y = 0; y < h; ++y )
+		{
+			const float * src = &data_[offset( x0, y0 + y )];
+
+			for ( int x = 0; x < w; ++x )
+			{
+				pixels[x] = _mm_loadu_ps( src + x * 4 );
+			}
+
+			ResolvePixels( pixels, w, settings, image.ptr<unsigned char>( y0 + y ) + x0 * 3 );
+		}
+	}
+}
+
+void Framebuffer::Resolve( const cv::Mat & src, cv::Mat & image, const ResolveSettings & settings )
+{
+	image.create( src.rows, src.cols, CV_8UC3 );
+
+#pragma omp parallel
+	{
+		// std::vector nezarucuje zarovnani __m128 na 16 bytu (Win32), radek ma kazde vlakno jen jeden
+		__m128 * pixels = static_cast<__m128 *>( _mm_malloc( sizeof( __m128 ) * MAX( src.cols, 1 ), ALIGNMENT ) );
+
+#pragma omp for schedule( dynamic, 4 )
+		for ( int y = 0; y < src.rows; ++y )
+		{
+			const float * row = src.ptr<float>( y );
+
+			for ( int x = 0; x < src.cols; ++x )
+			{
+				pixels[x] = _mm_setr_ps( row[x * 3], row[x * 3 + 1], row[x * 3 + 2], 1.0f );
+			}
+
+			ResolvePixels( pixels, src.cols, settings, image.ptr<unsigned char>( y ) );
+		}
+
+		_mm_free( pixels );
+	}
+}
@@ -0,0 +1,121 @@
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+/*! \enum Tonemap
+\brief Operator mapovani HDR hodnot do <0, 1> pri resolve.
+*/
+enum Tonemap
+{
+	TONEMAP_CLAMP, /*!< Jen orez, stejne jako drive cv::convertScaleAbs. */
+	TONEMAP_REINHARD, /*!< x / (1 + x). */
+	TONEMAP_ACES /*!< Aproximace ACES filmic krivky (Narkowicz 2015). */
+};
+
+/*! \struct ResolveSettings
+\brief Parametry prevodu akumulovanych hodnot na 8-bitovy obraz.
+*/
+struct ResolveSettings
+{
+	float exposure; /*!< Nasobitel pred tonemapovanim. */
+	Tonemap tonemap; /*!< Operator. */
+
+	ResolveSettings() : exposure( 1.0f ), tonemap( TONEMAP_CLAMP ) {}
+};
+
+/*! \class Framebuffer
+\brief Akumulacni float framebuffer ulozeny po dlazdicich.
+
+Pixely jedne dlazdice TILE_SIZE x TILE_SIZE lezi v pameti za sebou, kazdy
+jako ctyri floaty (b, g, r, vaha). Vlakno renderujici dlazdici tak zapisuje
+do souvisleho bloku a dve vlakna nikdy nesdili cache line. Vaha je soucet
+vah vzorku, resolve hodnotu pixelu vydeli vahou.
+
+Resolve (normalizace, expozice, tonemapovani a kvantizace na 8 bitu) je
+jediny pruchod pameti po dlazdicich, pixel se zpracuje jednim SSE registrem.
+Renderer jej pousti paralelne, nahled ve vlastnim vlakne seriove, aby vedle
+renderovacich vlaken nespoustel dalsi tym OpenMP.
+
+Framebuffer lze kopirovat, kopie recykluje pamet cile.
+*/
+class Framebuffer
+{
+public:
+	//! Vychozi konstruktor, prazdny framebuffer.
+	Framebuffer();
+
+	//! Pripravi framebuffer \a width x \a height a vynuluje ho, pamet se recykluje.
+	void Create( const int width, const int height );
+
+	//! Vynuluje vsechny pixely vcetne vah.
+	void Clear();
+
+	//! Nastavi pixel (x, y) na barvu \a bgr s vahou 1.
+	void Set( const int x, const int y, const cv::Vec3f & bgr )
+	{
+		float * p = pixel( x, y );
+		p[0] = bgr[0];
+		p[1] = bgr[1];
+		p[2] = bgr[2];
+		p[3] = 1.0f;
+	}
+
+	//! Pricte k pixelu (x, y) soucet vzorku \a bgr s celkovou vahou \a weight.
+	void Add( const int x, const int y, const cv::Vec3f & bgr, const float weight )
+	{
+		float * p = pixel( x, y );
+		p[0] += bgr[0];
+		p[1] += bgr[1];
+		p[2] += bgr[2];
+		p[3] += weight;
+	}
+
+	//! Akumulovana vaha pixelu (x, y).
+	float weight( const int x, const int y ) const
+	{
+		return data_[offset( x, y ) + 3];
+	}
+
+	//! Normalizovany obraz CV_32FC3 (BGR).
+	void ResolveFloat( cv::Mat & image ) const;
+
+	//! Normalizovany, tonemapovany a kvantizovany obraz CV_8UC3 (BGR).
+	/*!
+	\param parallel dlazdice zpracuje tym OpenMP, jinak volajici vlakno.
+	*/
+	void Resolve( cv::Mat & image, const ResolveSettings & settings, const bool parallel = true ) const;
+
+	//! Resolve obrazu CV_32FC3 (vaha 1) do CV_8UC3 stejnym jadrem.
+	static void Resolve( const cv::Mat & src, cv::Mat & image, const ResolveSettings & settings );
+
+	//! Seriovy resolve \a n pixelu BGR float (vaha 1) do \a n * 3 bytu BGR, napr. jednoho radku dlazdice.
+	static void ResolveSpan( const float * bgr, const int n, const ResolveSettings & settings, unsigned char * dst );
+
+	//! Nazev operatoru na Tonemap, -1 pro neznamy nazev.
+	static int ParseTonemap( const char * name );
+
+	int width() const;
+	int height() const;
+
+private:
+	//! Index prvni slozky pixelu (x, y).
+	int offset( const int x, const int y ) const
+	{
+		const int tile = ( y >> TILE_SHIFT ) * tiles_across_ + ( x >> TILE_SHIFT );
+
+		return ( ( tile << ( 2 * TILE_SHIFT ) ) + ( ( y & ( TILE_SIZE - 1 ) ) << TILE_SHIFT ) + ( x & ( TILE_SIZE - 1 ) ) ) * 4;
+	}
+
+	float * pixel( const int x, const int y )
+	{
+		return &data_[offset( x, y )];
+	}
+
+	int width_; /*!< Sirka obrazu [px]. */
+	int height_; /*!< Vyska obrazu [px]. */
+	int tiles_across_; /*!< Pocet dlazdic v radku. */
+	int tiles_down_; /*!< Pocet radku dlazdic. */
+
+	std::vector<float> data_; /*!< Dlazdice za sebou, v dlazdici radky pixelu (b, g, r, vaha). */
+};
+
+#endif
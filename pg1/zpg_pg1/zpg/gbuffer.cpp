@@ -0,0 +1,130 @@
+#include "stdafx.h"
+
+GBuffer::GBuffer()
+{
+	width_ = 0;
+	height_ = 0;
+
+	scene_ = NULL;
+	fov_y_ = 0;
+}
+
+bool GBuffer::Matches( const Camera & camera, RTCScene scene ) const
+{
+	if ( scene_ == NULL || scene_ != scene )
+	{
+		return false;
+	}
+
+	const Vector3 view_from = camera.view_from();
+	const Vector3 view_at = camera.view_at();
+
+	return camera.width() == width_ && camera.height() == height_ && camera.fov_y() == fov_y_ &&
+		view_from.x == view_from_.x && view_from.y == view_from_.y && view_from.z == view_from_.z &&
+		view_at.x == view_at_.x && view_at.y == view_at_.y && view_at.z == view_at_.z;
+}
+
+void GBuffer::Reset( const Camera & camera, RTCScene scene )
+{
+	width_ = camera.width();
+	height_ = camera.height();
+
+	scene_ = scene;
+	view_from_ = camera.view_from();
+	view_at_ = camera.view_at();
+	fov_y_ = camera.fov_y();
+
+	const size_t n = static_cast<size_t>( width_ ) * height_;
+
+	geom_id_.resize( n );
+	prim_id_.resize( n );
+	u_.resize( n );
+	v_.resize( n );
+
+	for ( int i = 0; i < 3; ++i )
+	{
+		position_[i].resize( n );
+		normal_[i].resize( n );
+	}
+}
+
+void GBuffer::Invalidate()
+{
+	scene_ = NULL;
+}
+
+void GBuffer::Store( const int x, const int y, const Ray & ray, const Vector3 & normal )
+{
+	const int i = index( x, y );
+
+	geom_id_[i] = ray.geomID;
+
+	if ( ray.geomID == RTC_INVALID_GEOMETRY_ID )
+	{
+		return;
+	}
+
+	prim_id_[i] = ray.primID;
+	u_[i] = ray.u;
+	v_[i] = ray.v;
+
+	const Vector3 p = ray.eval( ray.tfar );
+
+	position_[0][i] = p.x;
+	position_[1][i] = p.y;
+	position_[2][i] = p.z;
+
+	normal_[0][i] = normal.x;
+	normal_[1][i] = normal.y;
+	normal_[2][i] = normal.z;
+}
+
+int GBuffer::index( const int x, const int y ) const
+{
+	return y * width_ + x;
+}
+
+bool GBuffer::hit( const int i ) const
+{
+	return geom_id_[i] != RTC_INVALID_GEOMETRY_ID;
+}
+
+unsigned int GBuffer::geom_id( const int i ) const
+{
+	return geom_id_[i];
+}
+
+unsigned int GBuffer::prim_id( const int i ) const
+{
+	return prim_id_[i];
+}
+
+float GBuffer::u( const int i ) const
+{
+	return u_[i];
+}
+
+float GBuffer::v( const int i ) const
+{
+	return v_[i];
+}
+
+Vector3 GBuffer::position( const int i ) const
+{
+	return Vector3( position_[0][i], position_[1][i], position_[2][i] );
+}
+
+Vector3 GBuffer::normal( const int i ) const
+{
+	return Vector3( normal_[0][i], normal_[1][i], normal_[2][i] );
+}
+
+int GBuffer::width() const
+{
+	return width_;
+}
+
+int GBuffer::height() const
+{
+	return height_;
+}
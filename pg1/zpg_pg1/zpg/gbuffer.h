@@ -0,0 +1,72 @@
+#ifndef GBUFFER_H_
+#define GBUFFER_H_
+
+/*! \class GBuffer
+\brief Vysledky primarnich paprsku jedne kamery ulozene po slozkach (SoA).
+
+Pro kazdy pixel drzi geomID, primID, barycentricke souradnice (u, v),
+bod zasahu a stinovaci normalu otocenou k pozorovateli. Buffer je svazany
+s kamerou a scenou, pro ktere byl naplnen; dokud se nezmeni, renderovani
+dalsich variant materialu jen cte tento buffer a sceny se vubec nedotkne.
+
+Zmena geometrie uvnitr stejne sceny se z klice nepozna, v tom pripade je
+treba zavolat Invalidate.
+*/
+class GBuffer
+{
+public:
+	//! Vychozi konstruktor, prazdny neplatny buffer.
+	GBuffer();
+
+	//! Je buffer naplnen pro kameru \a camera a scenu \a scene?
+	bool Matches( const Camera & camera, RTCScene scene ) const;
+
+	//! Pripravi buffer velikosti kamery a svaze ho s \a camera a \a scene.
+	/*!
+	Obsah je po volani nedefinovany, pixely se vyplni volanim Store.
+	*/
+	void Reset( const Camera & camera, RTCScene scene );
+
+	//! Zrusi vazbu na kameru a scenu, pristi Matches vrati false.
+	void Invalidate();
+
+	//! Ulozi zasah paprsku \a ray v pixelu (x, y).
+	/*!
+	\param normal stinovaci normala otocena k pozorovateli, u minutych paprsku se ignoruje.
+	*/
+	void Store( const int x, const int y, const Ray & ray, const Vector3 & normal );
+
+	//! Index pixelu (x, y) do jednotlivych slozek.
+	int index( const int x, const int y ) const;
+
+	//! Zasahl paprsek pixelu \a i nejakou plochu?
+	bool hit( const int i ) const;
+
+	unsigned int geom_id( const int i ) const;
+	unsigned int prim_id( const int i ) const;
+	float u( const int i ) const;
+	float v( const int i ) const;
+	Vector3 position( const int i ) const;
+	Vector3 normal( const int i ) const;
+
+	int width() const;
+	int height() const;
+
+private:
+	int width_; /*!< Sirka bufferu [px]. */
+	int height_; /*!< Vyska bufferu [px]. */
+
+	RTCScene scene_; /*!< Scena, pro kterou byl buffer naplnen, NULL = neplatny. */
+	Vector3 view_from_; /*!< Oko kamery [m]. */
+	Vector3 view_at_; /*!< Cil kamery [m]. */
+	float fov_y_; /*!< Zorny uhel kamery [rad]. */
+
+	std::vector<unsigned int> geom_id_; /*!< Index plochy, RTC_INVALID_GEOMETRY_ID pri minuti. */
+	std::vector<unsigned int> prim_id_; /*!< Index trojuhelniku. */
+	std::vector<float> u_; /*!< Barycentricka souradnice u. */
+	std::vector<float> v_; /*!< Barycentricka souradnice v. */
+	std::vector<float> position_[3]; /*!< Slozky x, y, z bodu zasahu [m]. */
+	std::vector<float> normal_[3]; /*!< Slozky x, y, z stinovaci normaly. */
+};
+
+#endif
@@ -1,7 +1,6 @@
 #include "stdafx.h"
 #include "ggx_distribution.h"
 
-std::string path = "D:\\T4J\\VSB-pg1\\result\\";
 const int SamplesCount = 10;
 
 Vector3 ggx_distribution::orthogonal(const Vector3 & v)
@@ -60,56 +59,326 @@ float ggx_distribution::Ph(float theta, float phi, float alpha)
 	return (2 * SQR(alpha) * cos(theta) * sin(theta)) / SQR((SQR(alpha) - 1) * SQR(cos(theta)) + 1);
 }
 
-float ggx_distribution::GetTheta(float alpha)
+float ggx_distribution::GetTheta(float alpha, Sampler & sampler)
 {
-	float epsilon = Random();
+	float epsilon = sampler.Next1D();
 	return acos(sqrt((1 - epsilon) / (epsilon * (SQR(alpha) - 1) + 1)));
 	//return atan(alpha * sqrt(epsilon / (1 - epsilon)));
 }
 
 
-Vector3 ggx_distribution::GenerateGGXsampleVector(float roughness)//, Vector3 normal)
+Vector3 ggx_distribution::GenerateGGXsampleVector(float roughness, Sampler & sampler)//, Vector3 normal)
 {
-	int ii = 0;
+	// inverzni transformace cos(theta) * D(theta), zadne zamitani
+	float theta = GetTheta(ClampRoughness(roughness), sampler);
+	float phi = sampler.Next1D(0, M_PI * 2);
 
-	if (roughness >= 1.0f)
-		roughness = 0.99;
-	else if (roughness <= 0)
-		roughness = 0.01;
+	return Vector3::GetFromSpherical(theta, phi);
+}
+
+void ggx_distribution::GenerateGGXsampleVectors(float roughness, Sampler & sampler, int first, int count, Vector3 * samples)
+{
+	const float alpha = ClampRoughness(roughness);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 alpha2_1 = _mm_set1_ps(SQR(alpha) - 1);
 
-	while (true) //for (size_t i = 0; i < 5; i++)
+	for (int i = 0; i < count; i += 4)
 	{
-		float theta = GetTheta(roughness);
-		float phi = Random(0, M_PI * 2);
-		float random = Random();
+		// stejne dimenze jako GenerateGGXsampleVector, vysledky se shoduji az na presnost SinCos4
+		float epsilon[4] = { 0, 0, 0, 0 };
+		float u[4] = { 0, 0, 0, 0 };
+		const int n = MIN(4, count - i);
+
+		for (int j = 0; j < n; j++)
+		{
+			sampler.StartSample(first + i + j);
+			epsilon[j] = sampler.Next1D();
+			u[j] = sampler.Next1D();
+		}
+
+		const __m128 e = _mm_loadu_ps(epsilon);
+		const __m128 cos2 = _mm_div_ps(_mm_sub_ps(one, e), _mm_add_ps(_mm_mul_ps(e, alpha2_1), one));
+		const __m128 cos_theta = _mm_sqrt_ps(cos2);
+		const __m128 sin_theta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, cos2), _mm_setzero_ps()));
 
-		float ph = Ph(theta, phi, roughness) / M_PI * 2;
-		//printf("Pokus %d cyklus(%d) ph=%f  phi=%f\n", i, ii, ph, theta);
+		__m128 sin_phi, cos_phi;
+		SinCos4(_mm_mul_ps(_mm_loadu_ps(u), _mm_set1_ps(static_cast<float>(M_PI * 2))), sin_phi, cos_phi);
 
-		if (ph > 1 - roughness)
+		float x[4], y[4], z[4];
+		_mm_storeu_ps(x, _mm_mul_ps(sin_theta, cos_phi));
+		_mm_storeu_ps(y, _mm_mul_ps(sin_theta, sin_phi));
+		_mm_storeu_ps(z, cos_theta);
+
+		for (int j = 0; j < n; j++)
 		{
-			Vector3 rightV = Vector3::GetFromSpherical(theta, phi);
+			samples[i + j] = Vector3(x[j], y[j], z[j]);
+		}
+	}
+}
+
+Vector3 ggx_distribution::GenerateVNDFsampleVector(const Vector3 & viewLocal, float roughness, Sampler & sampler)
+{
+	// Heitz 2018, Sampling the GGX Distribution of Visible Normals
+	const float alpha = ClampRoughness(roughness);
+
+	// pohled do konfigurace polokoule (alpha = 1)
+	Vector3 Vh = Vector3(alpha * viewLocal.x, alpha * viewLocal.y, viewLocal.z);
+	Vh.Normalize();
+
+	// ortonormalni baze kolem Vh
+	const float lensq = SQR(Vh.x) + SQR(Vh.y);
+	Vector3 T1 = lensq > 0 ? Vector3(-Vh.y, Vh.x, 0) / sqrt(lensq) : Vector3(1, 0, 0);
+	Vector3 T2 = Vh.CrossProduct(T1);
+
+	// rovnomerny vzorek na disku premapovany na viditelnou cast polokoule
+	const float r = sqrt(sampler.Next1D());
+	const float phi = sampler.Next1D(0, M_PI * 2);
+	const float t1 = r * cos(phi);
+	const float s = 0.5f * (1.0f + Vh.z);
+	const float t2 = (1.0f - s) * sqrt(1.0f - SQR(t1)) + s * r * sin(phi);
+
+	Vector3 Nh = t1 * T1 + t2 * T2 + sqrt(MAX(0.0f, 1.0f - SQR(t1) - SQR(t2))) * Vh;
+
+	// zpet do konfigurace elipsoidu
+	Vector3 Ne = Vector3(alpha * Nh.x, alpha * Nh.y, MAX(0.0f, Nh.z));
+	Ne.Normalize();
+
+	return Ne;
+}
+
+float ggx_distribution::GGX_SmithG1(float NoX, float alpha)
+{
+	const float cos2 = SQR(NoX);
+	const float tan2 = (1 - cos2) / MAX(cos2, 1e-6f);
+
+	return 2 / (1 + sqrt(1 + SQR(alpha) * tan2));
+}
+
+Vector3 ggx_distribution::GGX_SpecularVNDF(CubeMap & cubeMapSpecular, Vector3 normal, Vector3 lightVector, float roughness, Vector3 F0, Vector3 *kS, int SamplesCount, Sampler & sampler, int lodSamplesCount)
+{
+	Vector3 radiance = Vector3(0, 0, 0);
+
+	normal.Normalize();
+	lightVector.Normalize();
+
+	const float NoV = normal.DotProduct(lightVector);
+
+	if (NoV <= 0)
+	{
+		return radiance;
+	}
+
+	const float alpha = ClampRoughness(roughness);
+
+	// stejna lokalni baze jako v TransformToWS
+	Vector3 o1 = orthogonal(normal);
+	o1.Normalize();
+	Vector3 o2 = o1.CrossProduct(normal);
+	o2.Normalize();
+
+	const Vector3 viewLocal = Vector3(lightVector.DotProduct(o1), lightVector.DotProduct(o2), NoV);
+
+	for (int i = 0; i < SamplesCount; i++)
+	{
+		sampler.StartSample(i);
+
+		Vector3 halfVector = TransformToWS(normal, GenerateVNDFsampleVector(viewLocal, roughness, sampler));
+		const float VoH = lightVector.DotProduct(halfVector);
 
-			rightV.Normalize();
+		Vector3 sampleVector = 2 * VoH * halfVector - lightVector;
+		const float NoL = normal.DotProduct(sampleVector);
 
-			rightV.Print();
-			
-			
+		Vector3 fresnel = Fresnel_Schlick(saturate(VoH), F0);
+		*kS += fresnel;
 
-			return rightV;
+		if (NoL <= 0)
+		{
+			continue; // vzorek pod horizontem
 		}
-		else
+
+		// pdf(L) = G1(V) D(H) / (4 NoV), z odhadu f * NoL / pdf zbyde F * G1(L)
+		const float weight = GGX_SmithG1(NoL, alpha);
+		const float pdf = GGX_SmithG1(NoV, alpha) * GGX_D(normal.DotProduct(halfVector), alpha) / (4 * NoV);
+
+		radiance += FetchEnvironment(cubeMapSpecular, sampleVector, pdf, lodSamplesCount) * fresnel * weight;
+	}
+
+	// Scale back for the samples count
+	*kS = *kS / SamplesCount;
+	(*kS).x = saturate((*kS).x);
+	(*kS).y = saturate((*kS).y);
+	(*kS).z = saturate((*kS).z);
+
+	return radiance / SamplesCount;
+}
+
+Vector3 ggx_distribution::GGX_SpecularPrefiltered(Vector3 normal, Vector3 lightVector, float roughness, Vector3 F0, Vector3 *kS)
+{
+	normal.Normalize();
+	lightVector.Normalize();
+
+	const float NoV = saturate(normal.DotProduct(lightVector));
+
+	Vector3 reflectionVector = reflect(normal, -lightVector);
+	reflectionVector.Normalize();
+
+	const Vector2 brdf = prefiltered->GetBRDF(NoV, roughness);
+	const Vector3 specularColor = F0 * brdf.x + Vector3(brdf.y, brdf.y, brdf.y);
+
+	*kS = Vector3(saturate(specularColor.x), saturate(specularColor.y), saturate(specularColor.z));
+
+	return prefiltered->GetSpecular(reflectionVector, roughness) * specularColor;
+}
+
+float ggx_distribution::FilteredLod(CubeMap & cubeMap, float pdf, int SamplesCount)
+{
+	const int size = cubeMap.GetFaceSize();
+
+	if (pdf <= 0 || size <= 0)
+	{
+		return 0;
+	}
+
+	const float omegaS = 1.0f / (SamplesCount * pdf);
+	const float omegaP = 4 * M_PI / (CUBEMAP_FACES * SQR(size));
+
+	// bez +1 z clanku, steny se filtruji kazda zvlast a hrube urovne rozmazou jas pres celou stenu
+	return MAX(0.0f, 0.5f * log2(omegaS / omegaP));
+}
+
+Vector3 ggx_distribution::FetchEnvironment(CubeMap & cubeMap, Vector3 & direction, float pdf, int SamplesCount)
+{
+	if (filtered_sampling)
+	{
+		return Vector3(cubeMap.GetTexel(direction, FilteredLod(cubeMap, pdf, SamplesCount)).data);
+	}
+
+	return Vector3(cubeMap.GetTexel(direction).data);
+}
+
+float ggx_distribution::GGX_D(float NoH, float alpha)
+{
+	const float alpha2 = SQR(alpha);
+
+	return alpha2 / (M_PI * SQR(SQR(NoH) * (alpha2 - 1) + 1));
+}
+
+float ggx_distribution::GGX_Pdf(float NoV, float NoH, float VoH, float alpha)
+{
+	if (sampling == GGX_SAMPLING_VNDF)
+	{
+		return GGX_SmithG1(NoV, alpha) * GGX_D(NoH, alpha) / (4 * NoV);
+	}
+
+	return GGX_D(NoH, alpha) * NoH / (4 * VoH);
+}
+
+Vector3 ggx_distribution::GGX_SpecularMIS(CubeMap & cubeMapSpecular, Vector3 normal, Vector3 lightVector, float roughness, Vector3 F0, Vector3 *kS, int SamplesCount, Sampler & sampler, int lodSamplesCount)
+{
+	Vector3 radiance = Vector3(0, 0, 0);
+
+	normal.Normalize();
+	lightVector.Normalize();
+
+	const float NoV = normal.DotProduct(lightVector);
+
+	if (NoV <= 0)
+	{
+		return radiance;
+	}
+
+	const float alpha = ClampRoughness(roughness);
+
+	// stejna lokalni baze jako v TransformToWS
+	Vector3 o1 = orthogonal(normal);
+	o1.Normalize();
+	Vector3 o2 = o1.CrossProduct(normal);
+	o2.Normalize();
+
+	const Vector3 viewLocal = Vector3(lightVector.DotProduct(o1), lightVector.DotProduct(o2), NoV);
+
+	for (int i = 0; i < SamplesCount; i++)
+	{
+		sampler.StartSample(i);
+
+		// 1. strategie: GGX, mikronormala kolem normaly (dimenze 0, 1)
+		Vector3 halfVector = (sampling == GGX_SAMPLING_VNDF) ?
+			GenerateVNDFsampleVector(viewLocal, roughness, sampler) : GenerateGGXsampleVector(roughness, sampler);
+		halfVector = TransformToWS(normal, halfVector);
+
+		float VoH = lightVector.DotProduct(halfVector);
+		Vector3 sampleVector = 2 * VoH * halfVector - lightVector;
+		float NoL = normal.DotProduct(sampleVector);
+
+		Vector3 fresnel = Fresnel_Schlick(saturate(VoH), F0);
+		*kS += fresnel;
+
+		if (NoL > 0 && VoH > 0)
+		{
+			const float NoH = normal.DotProduct(halfVector);
+			const float pdfBrdf = GGX_Pdf(NoV, NoH, VoH, alpha);
+			const float pdfEnv = environment_sampler->Pdf(sampleVector);
+
+			// f * NoL = F D G / (4 NoV)
+			const float brdf = GGX_D(NoH, alpha) * GGX_SmithG1(NoV, alpha) * GGX_SmithG1(NoL, alpha) / (4 * NoV);
+			const float weight = SQR(pdfBrdf) / (SQR(pdfBrdf) + SQR(pdfEnv));
+
+			// obe strategie maji po SamplesCount vzorcich, hustota vsech vzorku je soucet hustot
+			radiance += FetchEnvironment(cubeMapSpecular, sampleVector, pdfBrdf + pdfEnv, lodSamplesCount) * fresnel * (brdf * weight / pdfBrdf);
+		}
+
+		// 2. strategie: prostredi podle jasu (dimenze 2 az 5)
+		float pdfEnv = 0;
+		sampleVector = environment_sampler->Sample(sampler, pdfEnv);
+		NoL = normal.DotProduct(sampleVector);
+
+		halfVector = sampleVector + lightVector;
+		halfVector.Normalize();
+		VoH = lightVector.DotProduct(halfVector);
+
+		if (NoL > 0 && VoH > 0 && pdfEnv > 0)
 		{
-			ii++;
-			continue;
+			const float NoH = normal.DotProduct(halfVector);
+			const float pdfBrdf = GGX_Pdf(NoV, NoH, VoH, alpha);
+
+			const float brdf = GGX_D(NoH, alpha) * GGX_SmithG1(NoV, alpha) * GGX_SmithG1(NoL, alpha) / (4 * NoV);
+			const float weight = SQR(pdfEnv) / (SQR(pdfBrdf) + SQR(pdfEnv));
+
+			radiance += FetchEnvironment(cubeMapSpecular, sampleVector, pdfBrdf + pdfEnv, lodSamplesCount) * Fresnel_Schlick(VoH, F0) * (brdf * weight / pdfEnv);
 		}
 	}
 
+	// Scale back for the samples count
+	*kS = *kS / SamplesCount;
+	(*kS).x = saturate((*kS).x);
+	(*kS).y = saturate((*kS).y);
+	(*kS).z = saturate((*kS).z);
 
+	return radiance / SamplesCount;
 }
 
-Vector3 ggx_distribution::GGX_Specular(CubeMap cubeMapSpecular, Vector3 normal, Vector3 lightVector, float roughness, Vector3 F0, Vector3 *kS, int SamplesCount)
+Vector3 ggx_distribution::GGX_Specular(CubeMap & cubeMapSpecular, Vector3 normal, Vector3 lightVector, float roughness, Vector3 F0, Vector3 *kS, int SamplesCount, Sampler & sampler, int lodSamplesCount)
 {
+	if (lodSamplesCount <= 0)
+	{
+		lodSamplesCount = SamplesCount;
+	}
+
+	if (prefiltered != NULL)
+	{
+		return GGX_SpecularPrefiltered(normal, lightVector, roughness, F0, kS);
+	}
+
+	if (environment_sampler != NULL)
+	{
+		return GGX_SpecularMIS(cubeMapSpecular, normal, lightVector, roughness, F0, kS, SamplesCount, sampler, lodSamplesCount);
+	}
+
+	if (sampling == GGX_SAMPLING_VNDF)
+	{
+		return GGX_SpecularVNDF(cubeMapSpecular, normal, lightVector, roughness, F0, kS, SamplesCount, sampler, lodSamplesCount);
+	}
+
 	Vector3 radiance = Vector3(0, 0, 0);
 	float  NoV = saturate(normal.DotProduct(lightVector));
 
@@ -118,11 +387,17 @@ Vector3 ggx_distribution::GGX_Specular(CubeMap cubeMapSpecular, Vector3 normal,
 	Vector3 reflectionVector = reflect(normal, -lightVector);
 	reflectionVector.Normalize();
 
+	Vector3 samples[GGX_BATCH_SIZE];
+
 	for (int i = 0; i < SamplesCount; i++)
 	{
-		// Generate a sample vector in some local space
-		Vector3 sampleVector = GenerateGGXsampleVector(roughness);
-		sampleVector.Normalize();
+		// Generate sample vectors in some local space, GGX_BATCH_SIZE at once
+		if (i % GGX_BATCH_SIZE == 0)
+		{
+			GenerateGGXsampleVectors(roughness, sampler, i, MIN(GGX_BATCH_SIZE, SamplesCount - i), samples);
+		}
+
+		Vector3 sampleVector = samples[i % GGX_BATCH_SIZE];
 
 		////// Convert the vector in world space
 		sampleVector = TransformToWS(reflectionVector, sampleVector);
@@ -159,6 +434,68 @@ Vector3 ggx_distribution::GGX_Specular(CubeMap cubeMapSpecular, Vector3 normal,
 
 
 
+void ggx_distribution::TraceBlock(Camera & camera, const int bx, const int by, const int width, const int height, Ray * rays)
+{
+	if (packet_size == 1)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			const int x = bx + (i & 3);
+			const int y = by + (i >> 2);
+
+			if (x < width && y < height)
+			{
+				rays[i] = camera.GenerateRay(x, y);
+				rtcIntersect(scene, rays[i]);
+			}
+		}
+
+		return;
+	}
+
+	// blok 4x4 se vejde do jednoho RTCRay16, nebo do dvou RTCRay8 ci ctyr RTCRay4 ulozenych za sebou
+	RTCRay16 buffer;
+	RTCORE_ALIGN(64) int valid[16];
+	const int n = packet_size;
+
+	for (int p = 0; p < 16 / n; p++)
+	{
+		RTCRayN * packet = reinterpret_cast<RTCRayN *>(reinterpret_cast<char *>(&buffer) + p * (sizeof(RTCRay16) / 16) * n);
+		const int first = p * n;
+
+		camera.GenerateRayPacket(bx, by + first / 4, packet, n);
+
+		for (int i = 0; i < n; i++)
+		{
+			const int x = bx + ((first + i) & 3);
+			const int y = by + ((first + i) >> 2);
+
+			valid[i] = (x < width && y < height) ? -1 : 0;
+		}
+
+		switch (n)
+		{
+		case 4:
+			rtcIntersect4(valid, scene, *reinterpret_cast<RTCRay4 *>(packet));
+			break;
+
+		case 8:
+			rtcIntersect8(valid, scene, *reinterpret_cast<RTCRay8 *>(packet));
+			break;
+
+		case 16:
+			rtcIntersect16(valid, scene, *reinterpret_cast<RTCRay16 *>(packet));
+			break;
+		}
+
+		// rozbaleni paketu do skalarnich paprsku pro shading
+		for (int i = 0; i < n; i++)
+		{
+			rays[first + i].Unpack(packet, n, i);
+		}
+	}
+}
+
 int ggx_distribution::StartRender(Camera cameraSPhere, CubeMap cubeMap, Vector3 lightDir, int SamplesCount, GGXColor col, std::string info, float _ior, float _roughness, float _metallic)
 {
 	Vector3 baseColor = GetColorValue(col);
@@ -177,228 +514,621 @@ int ggx_distribution::StartRender(Camera cameraSPhere, CubeMap cubeMap, Vector3
 
 
 
-	float ior, roughness, metallic;
-	
-	if (_ior == -1) ior = 1 + baseColor.x;
-	else ior = _ior;
-
-	if (_roughness == -1) roughness = saturate(baseColor.y - EPSILON) + EPSILON;
-	else roughness = _roughness;
-
-	if (_metallic == -1) metallic = baseColor.z;
-	else metallic = _metallic;
-
+	const MaterialVariant variant = MakeVariant(col, _ior, _roughness, _metallic);
 
-	projRenderGGX_Distribution(scene, surfaces, cameraSPhere, cubeMap, cubeMap, lightDir, SamplesCount, baseColor, ior, roughness, metallic, nameColor);
+	projRenderGGX_Distribution(scene, surfaces, cameraSPhere, cubeMap, cubeMap, lightDir, SamplesCount, baseColor, variant.ior, variant.roughness, variant.metallic, nameColor);
 	//testGeometryTerm(scene, surfaces, cameraSPhere, cubeMap, cubeMap, SamplesCount, baseColor, ior, roughness, metallic, nameColor);
 	return 0;
 }
 
 
-int ggx_distribution::projRenderGGX_Distribution(RTCScene & scene, std::vector<Surface *> & surfaces, Camera & camera, CubeMap cubeMap, CubeMap specularCubeMap, Vector3 lightVector, int SamplesCount, Vector3 baseColor, float ior, float roughness, float metallic, std::string nameColor)
+Vector3 ggx_distribution::ShadingNormal(const Ray & ray)
 {
-	cv::Mat src_8uc3_img(480, 640, CV_32FC3);
+	Surface * surface = surfaces[ray.geomID];
 
-	std::string str;
-	
+	// indexovane plochy nemaji pole trojuhelniku
+	Vector3 normal = surface->normal(ray.primID, ray.u, ray.v);
 
-	str = nameColor + "_" + std::to_string(SamplesCount) + " metallic_" + std::to_string(metallic) + " roughness_" + std::to_string(roughness) + " " + "ior_" + std::to_string(ior);
-	
+	normal = normal.DotProduct(ray.dir) < 0 ? normal : -normal;
+	normal.Normalize();
 
-	cv::namedWindow(str, 1);
+	return normal;
+}
 
-	for (int x = 0; x < 640; x++)
+bool ggx_distribution::PrepareGBuffer(Camera & camera, const int width, const int height)
+{
+	if (gbuffer == NULL || camera.width() != width || camera.height() != height)
 	{
-#pragma omp parallel for schedule(dynamic, 5) shared(scene, surfaces, src_8uc3_img, camera)
-		for (int y = 0; y < 480; y++)
-		{
+		return false;
+	}
 
-			Ray rtc_ray = camera.GenerateRay(x, y);
+	if (!gbuffer->Matches(camera, scene))
+	{
+		gbuffer->Reset(camera, scene);
 
-			//Vector3 re = phongRecursion(0, rtc_ray, Vector3(lightPosition[0], lightPosition[1], lightPosition[2]), camera.view_from(), scene, surfaces, cubeMap);
+		TraceTiles(camera, width, height, [&](const int x, const int y, Ray & rtc_ray)
+		{
+			gbuffer->Store(x, y, rtc_ray, (rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID) ? ShadingNormal(rtc_ray) : Vector3(0, 0, 0));
+		});
+	}
 
+	return true;
+}
 
+MaterialVariant ggx_distribution::MakeVariant(GGXColor col, float _ior, float _roughness, float _metallic)
+{
+	MaterialVariant variant;
+	Vector3 baseColor = GetColorValue(col);
 
+	variant.name = GetColorString(col);
+	variant.base_color = baseColor;
 
-			rtcIntersect(scene, rtc_ray);
+	if (_ior == -1) variant.ior = 1 + baseColor.x;
+	else variant.ior = _ior;
 
+	if (_roughness == -1) variant.roughness = saturate(baseColor.y - EPSILON) + EPSILON;
+	else variant.roughness = _roughness;
 
+	if (_metallic == -1) variant.metallic = baseColor.z;
+	else variant.metallic = _metallic;
 
-			if (rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID)
-			{
+	return variant;
+}
 
-				
-				Vector3 ret;
-				Surface * surface = surfaces[rtc_ray.geomID];
-				Triangle & triangle = surface->get_triangle(rtc_ray.primID);
-				
-				Vector3 normal = triangle.normal(rtc_ray.u, rtc_ray.v);
+void ggx_distribution::ShadeMaterialMatrix(CubeMap & specularCubeMap, const MaterialMatrix & matrix, Vector3 normal, Vector3 lightVector, int SamplesCount, Sampler & sampler, Vector3 * colors)
+{
+	const int n = matrix.size();
+	const Vector3 irradiance = (sh_irradiance != NULL) ? sh_irradiance->GetIrradiance(normal) : Vector3(0, 0, 0);
 
-				
-				lightVector.Normalize();
+	RTCORE_ALIGN(16) float r[MATERIAL_MATRIX_MAX_VARIANTS] = { 0 };
+	RTCORE_ALIGN(16) float g[MATERIAL_MATRIX_MAX_VARIANTS] = { 0 };
+	RTCORE_ALIGN(16) float b[MATERIAL_MATRIX_MAX_VARIANTS] = { 0 };
+	RTCORE_ALIGN(16) float kr[MATERIAL_MATRIX_MAX_VARIANTS] = { 0 };
+	RTCORE_ALIGN(16) float kg[MATERIAL_MATRIX_MAX_VARIANTS] = { 0 };
+	RTCORE_ALIGN(16) float kb[MATERIAL_MATRIX_MAX_VARIANTS] = { 0 };
+	RTCORE_ALIGN(16) float pdfs[MATERIAL_MATRIX_MAX_VARIANTS];
 
+	normal.Normalize();
+	lightVector.Normalize();
 
-				normal = normal.DotProduct(rtc_ray.dir) < 0 ? normal : -normal;
-				normal.Normalize();
+	const float NoV = normal.DotProduct(lightVector);
 
-				float F0_f = saturate((1.0 - ior) / (1.0 + ior));
-				Vector3 F0 = Vector3(F0_f, F0_f, F0_f);
-				F0 = F0 * F0;
-				
-				F0 = lerp(F0, baseColor, metallic);
+	if (prefiltered != NULL)
+	{
+		// split-sum nema vzorky, varianty se jen vyhodnoti kazda zvlast
+		for (int j = 0; j < n; j++)
+		{
+			Vector3 ks = Vector3(0, 0, 0);
+			const Vector3 specular = GGX_SpecularPrefiltered(normal, lightVector, matrix.variant(j).roughness, matrix.f0(j), &ks);
 
-				
+			r[j] = specular.x; g[j] = specular.y; b[j] = specular.z;
+			kr[j] = ks.x; kg[j] = ks.y; kb[j] = ks.z;
+		}
 
-				Vector3 ks = Vector3(0, 0, 0);
-				Vector3 specular = GGX_Specular(specularCubeMap, normal, lightVector, roughness, F0, &ks, SamplesCount);
-				Vector3 kd = (Vector3(1, 1, 1) - ks) * (1-metallic);
+		SamplesCount = 1;
+	}
+	else if (NoV > 0)
+	{
+		// smes: rovnomerne jedna z GGX laloku variant, pripadne prostredi podle jasu
+		const int components = n + ((environment_sampler != NULL) ? 1 : 0);
+		const bool vndf = sampling == GGX_SAMPLING_VNDF;
 
-				Vector3 irradiance = Vector3(cubeMap.GetTexel(normal).data);
+		Vector3 o1 = orthogonal(normal);
+		o1.Normalize();
+		Vector3 o2 = o1.CrossProduct(normal);
+		o2.Normalize();
 
-				Vector3 diffuse = baseColor * irradiance;
+		const Vector3 viewLocal = Vector3(lightVector.DotProduct(o1), lightVector.DotProduct(o2), NoV);
 
-				ret = specular;//kd * diffuse + specular;
+		for (int i = 0; i < SamplesCount; i++)
+		{
+			sampler.StartSample(i);
 
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(ret.z, ret.y, ret.x);
+			const int c = MIN(static_cast<int>(sampler.Next1D() * components), components - 1);
+			Vector3 sampleVector;
 
+			if (c < n)
+			{
+				Vector3 halfVector = vndf ?
+					GenerateVNDFsampleVector(viewLocal, matrix.alpha(c), sampler) : GenerateGGXsampleVector(matrix.alpha(c), sampler);
+				halfVector = TransformToWS(normal, halfVector);
 
+				sampleVector = 2 * lightVector.DotProduct(halfVector) * halfVector - lightVector;
 			}
 			else
 			{
-				Color4 col = Color4(0.5f, 0.5f, 0.5f, 1.0f); 
-				//cubeMap.GetTexel(Vector3(rtc_ray.dir));
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(col.b, col.g, col.r);
+				float pdfEnv = 0;
+				sampleVector = environment_sampler->Sample(sampler, pdfEnv);
+			}
+
+			const float NoL = normal.DotProduct(sampleVector);
 
+			Vector3 halfVector = sampleVector + lightVector;
+			halfVector.Normalize();
+
+			const float VoH = lightVector.DotProduct(halfVector);
+
+			if (NoL <= 0 || VoH <= 0)
+			{
+				// vzorek pod horizontem, Fresnel se pocita stejne jako v GGX_Specular
+				matrix.AccumulateFresnel(VoH, kr, kg, kb);
+				continue;
 			}
 
+			const float NoH = normal.DotProduct(halfVector);
 
+			// hustota smesi (balance heuristic pres vsechny komponenty)
+			float pdf = matrix.Pdf(NoV, NoH, VoH, vndf, pdfs);
+			if (environment_sampler != NULL) pdf += environment_sampler->Pdf(sampleVector);
+			pdf /= components;
 
+			if (pdf <= 0)
+			{
+				matrix.AccumulateFresnel(VoH, kr, kg, kb);
+				continue;
+			}
+
+			// jedno cteni prostredi pro vsechny varianty
+			const Vector3 radiance = FetchEnvironment(specularCubeMap, sampleVector, pdf, SamplesCount) / pdf;
+
+			matrix.Accumulate(NoV, NoL, NoH, VoH, radiance, r, g, b, kr, kg, kb);
 		}
+	}
 
-		cv::imshow(str, src_8uc3_img); // display image
+	for (int j = 0; j < n; j++)
+	{
+		const MaterialVariant & variant = matrix.variant(j);
+
+		// odraz i ks jsou prumery pres vsechny vzorky
+		const Vector3 specular = Vector3(r[j], g[j], b[j]) / SamplesCount;
+		const Vector3 ks = Vector3(saturate(kr[j] / SamplesCount), saturate(kg[j] / SamplesCount), saturate(kb[j] / SamplesCount));
+		const Vector3 kd = (Vector3(1, 1, 1) - ks) * (1 - variant.metallic);
 
-		cv::moveWindow(str, 10, 50);
+		// skladani jako ShadeGGX, odraz je ale vzdy fyzikalni GGX lalok (odpovida --vndf, --env-sampling nebo
+		// --prefiltered), vychozi GGX_SAMPLING_REFLECTION v ShadeGGX vraci jen ladici geometricky clen
+		colors[j] = (sh_irradiance != NULL) ? kd * (variant.base_color * irradiance) + specular : specular;
+	}
+}
 
-		
+int ggx_distribution::RenderMaterialMatrix(Camera & camera, CubeMap & cubeMap, Vector3 lightDir, int SamplesCount, const MaterialMatrix & matrix, std::string info, int sheetColumns)
+{
+	const int n = matrix.size();
 
-		cvWaitKey(1);
+	if (n == 0)
+	{
+		return -1;
 	}
 
-	cv::Mat finalImage;
+	// prvni varianta se kresli do zobrazovaneho obrazu, ostatni vedle
+	std::vector<cv::Mat> images(n);
 
-	cv::convertScaleAbs(src_8uc3_img, finalImage, 255.0f);
+	for (int j = 0; j < n; j++)
+	{
+		images[j].create(camera.height(), camera.width(), CV_32FC3);
+	}
 
+	const std::string str = info + " matrix_" + std::to_string(n) + "_" + std::to_string(SamplesCount);
 
-	std::string resultPath = path + str + ".png";
-	cv::imwrite(resultPath, finalImage);
-	std::cout << resultPath << std::endl;
-	//cvSaveImage("D:\\" + str + ".jpg", src_8uc3_img);
-	//cvWaitKey(0);
-	//std::string str = "GGX_Distribution metallic(" + std::to_string(metallic) + ")  roughness(" + std::to_string(roughness) + ")";
+	if (prefiltered == NULL && environment_sampler == NULL && sampling == GGX_SAMPLING_REFLECTION)
+	{
+		printf("Material matrix shades the physical GGX lobe, compare it with --vndf, --env-sampling or --prefiltered renders.\n");
+	}
+
+	if (preview != NULL) preview->Show(str, images[0]);
+
+	lightDir.Normalize();
+
+	auto shade = [&](const int x, const int y, const bool hit, const Vector3 & normal) -> cv::Vec3f
+	{
+		Vector3 colors[MATERIAL_MATRIX_MAX_VARIANTS];
+
+		if (hit)
+		{
+			Sampler sampler(seed, sampler_type);
+			sampler.StartPixel(x, y);
+
+			ShadeMaterialMatrix(cubeMap, matrix, normal, lightDir, SamplesCount, sampler, colors);
+		}
+		else
+		{
+			for (int j = 0; j < n; j++)
+			{
+				colors[j] = Vector3(0.5f, 0.5f, 0.5f);
+			}
+		}
+
+		for (int j = 1; j < n; j++)
+		{
+			images[j].at<cv::Vec3f>(y, x) = cv::Vec3f(colors[j].z, colors[j].y, colors[j].x);
+		}
+
+		return cv::Vec3f(colors[0].z, colors[0].y, colors[0].x);
+	};
+
+	if (PrepareGBuffer(camera, images[0].cols, images[0].rows))
+	{
+		ShadeTiles(images[0], [&](const int x, const int y, const int i) -> cv::Vec3f
+		{
+			return shade(x, y, gbuffer->hit(i), gbuffer->normal(i));
+		});
+	}
+	else
+	{
+		RenderTiles(camera, images[0], [&](const int x, const int y, Ray & rtc_ray) -> cv::Vec3f
+		{
+			const bool hit = rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID;
+
+			return shade(x, y, hit, hit ? ShadingNormal(rtc_ray) : Vector3(0, 0, 0));
+		});
+	}
+
+	if (preview != NULL) preview->Finish();
+
+	for (int j = 0; j < n; j++)
+	{
+		const MaterialVariant & variant = matrix.variant(j);
+
+		SaveResult(images[j], info + " (" + variant.name + ") _" + std::to_string(SamplesCount) + " metallic_" + std::to_string(variant.metallic) + " roughness_" + std::to_string(variant.roughness) + " " + "ior_" + std::to_string(variant.ior));
+	}
+
+	if (sheetColumns > 0)
+	{
+		const int rows = (n + sheetColumns - 1) / sheetColumns;
+		cv::Mat sheet(rows * images[0].rows, MIN(sheetColumns, n) * images[0].cols, CV_32FC3, cv::Scalar(0, 0, 0));
+
+		for (int j = 0; j < n; j++)
+		{
+			images[j].copyTo(sheet(cv::Rect((j % sheetColumns) * images[0].cols, (j / sheetColumns) * images[0].rows, images[0].cols, images[0].rows)));
+		}
 
+		SaveResult(sheet, str + " sheet");
+	}
 
 	return 0;
 }
 
+void ggx_distribution::SaveDenoised(cv::Mat & image, const FeatureBuffers & features, const std::string & name)
+{
+	SaveResult(image, name);
 
-int ggx_distribution::testGeometryTerm(RTCScene & scene, std::vector<Surface *> & surfaces, Camera & camera, CubeMap cubeMap, CubeMap specularCubeMap, Vector3 lightDir, int SamplesCount, Vector3 baseColor, float ior, float roughness, float metallic, std::string nameColor)
+	cv::Mat denoised;
+
+	if (denoiser != NULL && denoiser->Filter(image, features, denoised) == 0)
+	{
+		SaveResult(denoised, name + " denoised");
+	}
+
+	if (output_formats & OUTPUT_EXR)
+	{
+		// prazdne vrstvy (bez denoiseru nejsou features) se preskoci
+		std::vector<OutputLayer> layers;
+		layers.push_back(OutputLayer("", image, "BGR"));
+		layers.push_back(OutputLayer("denoised", denoised, "BGR"));
+		layers.push_back(OutputLayer("albedo", features.albedo, "BGR"));
+		layers.push_back(OutputLayer("normal", features.normal, "XYZ"));
+		layers.push_back(OutputLayer("depth", features.depth, "Z"));
+		layers.push_back(OutputLayer("id", features.id, "V"));
+
+		WriteLayers(output_dir + name + ".exr", layers);
+	}
+}
+
+void ggx_distribution::WriteImage(const std::string & fileName, const cv::Mat & image)
 {
-	cv::Mat src_8uc3_img(480, 640, CV_32FC3);
+	if (output != NULL)
+	{
+		output->Write(fileName, image);
+	}
+	else if (OutputSink::Save(fileName, image) == 0)
+	{
+		std::cout << fileName << std::endl;
+	}
+}
 
-	std::string str;
+void ggx_distribution::WriteLayers(const std::string & fileName, const std::vector<OutputLayer> & layers)
+{
+	if (output != NULL)
+	{
+		output->WriteLayers(fileName, layers);
+	}
+	else if (OutputSink::SaveEXR(fileName, layers) == 0)
+	{
+		std::cout << fileName << std::endl;
+	}
+}
 
-	str = nameColor + "_" + std::to_string(SamplesCount) + " metallic_" + std::to_string(metallic) + " roughness_" + std::to_string(roughness) + " " + "ior_" + std::to_string(ior);
+void ggx_distribution::SaveResult(cv::Mat & image, const std::string & name)
+{
+	if (output_formats & OUTPUT_PNG)
+	{
+		cv::Mat finalImage;
+
+		Framebuffer::Resolve(image, finalImage, resolve);
 
+		WriteImage(output_dir + name + ".png", finalImage);
+	}
 
-	cv::namedWindow(str, 1);
+	if (output_formats & OUTPUT_PFM)
+	{
+		WriteImage(output_dir + name + ".pfm", image);
+	}
+}
 
-	for (int x = 0; x < 640; x++)
+void ggx_distribution::SaveResult(const Framebuffer & image, const std::string & name)
+{
+	if (output_formats & OUTPUT_PNG)
 	{
-#pragma omp parallel for schedule(dynamic, 5) shared(scene, surfaces, src_8uc3_img, camera)
-		for (int y = 0; y < 480; y++)
-		{
+		cv::Mat finalImage;
+
+		image.Resolve(finalImage, resolve);
 
-			Ray rtc_ray = camera.GenerateRay(x, y);
+		WriteImage(output_dir + name + ".png", finalImage);
+	}
 
-			rtcIntersect(scene, rtc_ray);
+	if (output_formats & OUTPUT_PFM)
+	{
+		cv::Mat finalImage;
 
+		image.ResolveFloat(finalImage);
 
+		WriteImage(output_dir + name + ".pfm", finalImage);
+	}
+}
 
-			if (rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID)
+Vector3 ggx_distribution::ShadeGGX(CubeMap & cubeMap, CubeMap & specularCubeMap, Vector3 normal, Vector3 lightVector, int SamplesCount, Vector3 baseColor, Vector3 F0, float roughness, float metallic, Sampler & sampler, int lodSamplesCount)
+{
+	Vector3 ks = Vector3(0, 0, 0);
+	Vector3 specular = GGX_Specular(specularCubeMap, normal, lightVector, roughness, F0, &ks, SamplesCount, sampler, lodSamplesCount);
+	Vector3 kd = (Vector3(1, 1, 1) - ks) * (1-metallic);
+
+	if (sh_irradiance != NULL)
+	{
+		Vector3 diffuse = baseColor * sh_irradiance->GetIrradiance(normal);
+
+		return kd * diffuse + specular;
+	}
+
+	Vector3 irradiance = Vector3(cubeMap.GetTexel(normal).data);
+
+	Vector3 diffuse = baseColor * irradiance;
+
+	return specular;//kd * diffuse + specular;
+}
+
+Vector3 ggx_distribution::ShadeAdaptive(CubeMap & cubeMap, CubeMap & specularCubeMap, Vector3 normal, Vector3 lightVector, Vector3 baseColor, Vector3 F0, float roughness, float metallic, Sampler & sampler, int & samplesUsed)
+{
+	// Welfordova online stredni hodnota a rozptyl, pozorovani je prumer jednoho kola
+	const int maxRounds = MAX(adaptive.min_rounds, adaptive.max_samples / adaptive.round_samples);
+
+	Vector3 mean = Vector3(0, 0, 0);
+	float meanY = 0;
+	float m2 = 0;
+	int rounds = 0;
+
+	while (rounds < maxRounds)
+	{
+		sampler.SetFirstSample(rounds * adaptive.round_samples);
+
+		// mip uroven podle celeho rozpoctu pixelu, ne podle jednoho kola, jinak by vysledek zavisel na round_samples
+		const Vector3 color = ShadeGGX(cubeMap, specularCubeMap, normal, lightVector, adaptive.round_samples, baseColor, F0, roughness, metallic, sampler, maxRounds * adaptive.round_samples);
+		const float y = 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+
+		rounds++;
+		mean += (color - mean) / rounds;
+
+		const float delta = y - meanY;
+		meanY += delta / rounds;
+		m2 += delta * (y - meanY);
+
+		if (rounds >= MAX(2, adaptive.min_rounds))
+		{
+			// polovina 95% intervalu spolehlivosti odhadu stredni hodnoty
+			const float halfWidth = 1.96f * sqrt(m2 / (rounds - 1) / rounds);
+
+			if (halfWidth <= adaptive.threshold)
 			{
+				break;
+			}
+		}
+	}
+
+	samplesUsed = rounds * adaptive.round_samples;
+
+	return mean;
+}
+
+int ggx_distribution::projRenderGGX_Distribution(RTCScene & scene, std::vector<Surface *> & surfaces, Camera & camera, CubeMap cubeMap, CubeMap specularCubeMap, Vector3 lightVector, int SamplesCount, Vector3 baseColor, float ior, float roughness, float metallic, std::string nameColor)
+{
+	const int width = camera.width();
+	const int height = camera.height();
+
+	// pri streamovani se cely obraz nikdy nealokuje
+	if (!stream_tiles) framebuffer.Create(width, height);
 
+	std::string str;
+	
 
-				Vector3 ret;
-				Surface * surface = surfaces[rtc_ray.geomID];
-				Triangle & triangle = surface->get_triangle(rtc_ray.primID);
-				
-				Vector3 normal = triangle.normal(rtc_ray.u, rtc_ray.v);
+	if (!snapshots.empty()) SamplesCount = snapshots.back();
 
+	str = nameColor + "_" + std::to_string(SamplesCount) + " metallic_" + std::to_string(metallic) + " roughness_" + std::to_string(roughness) + " " + "ior_" + std::to_string(ior);
+	
 
-				
-				lightDir.Normalize();
+	if (preview != NULL && !stream_tiles) preview->Show(str, framebuffer, resolve);
 
+	lightVector.Normalize();
 
-				normal = normal.DotProduct(rtc_ray.dir) < 0 ? normal : -normal;
-				normal.Normalize();
+	float F0_f = saturate((1.0 - ior) / (1.0 + ior));
+	Vector3 F0 = Vector3(F0_f, F0_f, F0_f);
+	F0 = F0 * F0;
 
-				Vector3 h = (lightDir + normal);
-				h.Normalize();
+	F0 = lerp(F0, baseColor, metallic);
 
-				float geom = 0;
+	cv::Mat samplesPerPixel;
+	if (adaptive.enabled && !stream_tiles) samplesPerPixel = cv::Mat::zeros(height, width, CV_32SC1);
 
-				Vector3 reflectionVector = reflect(normal, -lightDir);
-				reflectionVector.Normalize();
+	if (stream_tiles && (!snapshots.empty() || denoiser != NULL))
+	{
+		printf("Streamed output keeps only the final image, snapshots and denoising skipped.\n");
+	}
 
-			
-				for (int i = 0; i < SamplesCount; i++)
-				{
-					Vector3 sampleVector = GenerateGGXsampleVector(roughness);
-					sampleVector.Normalize();
-					sampleVector = TransformToWS(reflectionVector, sampleVector);
+	// progresivne: vzorky snimku navazuji na vzorky predchoziho, posledni snimek je framebuffer
+	const int noSnapshots = stream_tiles ? 0 : static_cast<int>(snapshots.size());
+	std::vector<cv::Mat> snapshotImages(MAX(0, noSnapshots - 1));
 
-					Vector3 halfVector = sampleVector - normal;
-					halfVector.Normalize();
+	for (int i = 0; i + 1 < noSnapshots; i++)
+	{
+		snapshotImages[i].create(height, width, CV_32FC3);
+	}
 
-					geom += GGX_PartialGeometryTerm(lightDir, normal, halfVector, roughness) * GGX_PartialGeometryTerm(sampleVector, normal, halfVector, roughness);
+	// vlastnosti zasahu pro denoiser
+	FeatureBuffers features;
+	if (denoiser != NULL && !stream_tiles) features.Create(width, height);
 
-				}
+	if (noSnapshots > 0 && adaptive.enabled)
+	{
+		printf("Progressive snapshots take precedence, adaptive sampling disabled.\n");
+	}
+
+	auto shade = [&](const int x, const int y, const bool hit, const Vector3 & normal) -> cv::Vec3f
+	{
+		if (hit)
+		{
+			Vector3 ret;
+
+			Sampler sampler(seed, sampler_type);
+			sampler.StartPixel(x, y);
 
-				geom /= SamplesCount;
-				ret = Vector3(geom, geom, geom);
+			if (noSnapshots > 0)
+			{
+				Vector3 sum = Vector3(0, 0, 0);
+				int first = 0;
 
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(ret.z, ret.y, ret.x);
+				for (int i = 0; i < noSnapshots; i++)
+				{
+					sampler.SetFirstSample(first);
+					// mip uroven podle kumulativniho poctu vzorku snimku, ne podle velikosti useku
+					sum += ShadeGGX(cubeMap, specularCubeMap, normal, lightVector, snapshots[i] - first, baseColor, F0, roughness, metallic, sampler, snapshots[i]) * static_cast<float>(snapshots[i] - first);
+					first = snapshots[i];
 
+					ret = sum / static_cast<float>(first);
 
+					if (i + 1 < noSnapshots)
+					{
+						snapshotImages[i].at<cv::Vec3f>(y, x) = cv::Vec3f(ret.z, ret.y, ret.x);
+					}
+				}
+			}
+			else if (adaptive.enabled)
+			{
+				int samplesUsed = 0;
+				ret = ShadeAdaptive(cubeMap, specularCubeMap, normal, lightVector, baseColor, F0, roughness, metallic, sampler, samplesUsed);
+				if (!samplesPerPixel.empty()) samplesPerPixel.at<int>(y, x) = samplesUsed;
 			}
 			else
 			{
-				Color4 col = Color4(0.5f, 0.5f, 0.5f, 1.0f); //cubeMap.GetTexel(Vector3(rtc_ray.dir));
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(col.b, col.g, col.r);
+				ret = ShadeGGX(cubeMap, specularCubeMap, normal, lightVector, SamplesCount, baseColor, F0, roughness, metallic, sampler);
+			}
 
+			return cv::Vec3f(ret.z, ret.y, ret.x);
+		}
+		else
+		{
+			Color4 col = Color4(0.5f, 0.5f, 0.5f, 1.0f); 
+			//cubeMap.GetTexel(Vector3(rtc_ray.dir));
+
+			for (int i = 0; i + 1 < noSnapshots; i++)
+			{
+				snapshotImages[i].at<cv::Vec3f>(y, x) = cv::Vec3f(col.b, col.g, col.r);
 			}
 
+			return cv::Vec3f(col.b, col.g, col.r);
+		}
+	};
+
+	if (stream_tiles)
+	{
+		TiledImageWriter writer;
+		const std::string resultPath = output_dir + str + ".tif";
+
+		if (writer.Open(resultPath, width, height, TILE_SIZE, stream_format, resolve) != 0)
+		{
+			return -1;
+		}
+
+		StreamTiles(camera, writer, [&](const int x, const int y, Ray & rtc_ray) -> cv::Vec3f
+		{
+			const bool hit = rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID;
 
+			return shade(x, y, hit, hit ? ShadingNormal(rtc_ray) : Vector3(0, 0, 0));
+		});
 
+		if (writer.Close() != 0)
+		{
+			return -1;
 		}
 
-		cv::imshow(str, src_8uc3_img); // display image
+		std::cout << resultPath << std::endl;
+
+		return 0;
+	}
 
-		cv::moveWindow(str, 10, 50);
+	if (PrepareGBuffer(camera, width, height))
+	{
+		ShadeTiles(framebuffer, [&](const int x, const int y, const int i) -> cv::Vec3f
+		{
+			if (denoiser != NULL && gbuffer->hit(i))
+			{
+				features.Store(x, y, gbuffer->geom_id(i), baseColor, gbuffer->normal(i), camera.orthogonal_depth(gbuffer->position(i)));
+			}
 
+			return shade(x, y, gbuffer->hit(i), gbuffer->normal(i));
+		});
+	}
+	else
+	{
+		RenderTiles(camera, framebuffer, [&](const int x, const int y, Ray & rtc_ray) -> cv::Vec3f
+		{
+			const bool hit = rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID;
+			const Vector3 normal = hit ? ShadingNormal(rtc_ray) : Vector3(0, 0, 0);
 
+			if (denoiser != NULL && hit)
+			{
+				features.Store(x, y, rtc_ray.geomID, baseColor, normal, camera.orthogonal_depth(rtc_ray.eval(rtc_ray.tfar)));
+			}
 
-		cvWaitKey(1);
+			return shade(x, y, hit, normal);
+		});
 	}
 
-	cv::Mat finalImage;
+	if (preview != NULL) preview->Finish();
+
+	if (noSnapshots > 0)
+	{
+		for (int i = 0; i + 1 < noSnapshots; i++)
+		{
+			SaveDenoised(snapshotImages[i], features, nameColor + "_" + std::to_string(snapshots[i]) + " metallic_" + std::to_string(metallic) + " roughness_" + std::to_string(roughness) + " " + "ior_" + std::to_string(ior));
+		}
+	}
+	else if (!samplesPerPixel.empty())
+	{
+		const int hits = cv::countNonZero(samplesPerPixel);
+		const double total = cv::sum(samplesPerPixel)[0];
 
-	cv::convertScaleAbs(src_8uc3_img, finalImage, 255.0f);
+		printf("Adaptive sampling: %.1f samples per hit pixel (%d..%d).\n", (hits > 0) ? total / hits : 0.0,
+			adaptive.round_samples * adaptive.min_rounds, adaptive.max_samples);
+	}
 
+	if (denoiser != NULL || (output_formats & OUTPUT_EXR))
+	{
+		cv::Mat image;
+		framebuffer.ResolveFloat(image);
 
-	std::string resultPath = path + str + ".png";
-	cv::imwrite(resultPath, finalImage);
-	std::cout << resultPath << std::endl;
+		SaveDenoised(image, features, str);
+	}
+	else
+	{
+		SaveResult(framebuffer, str);
+	}
 	//cvSaveImage("D:\\" + str + ".jpg", src_8uc3_img);
 	//cvWaitKey(0);
 	//std::string str = "GGX_Distribution metallic(" + std::to_string(metallic) + ")  roughness(" + std::to_string(roughness) + ")";
@@ -408,116 +1138,142 @@ int ggx_distribution::testGeometryTerm(RTCScene & scene, std::vector<Surface *>
 }
 
 
-int ggx_distribution::testSamplingOnSphere(RTCScene & scene, std::vector<Surface *> & surfaces, Camera & camera, cv::Vec3f lightPosition, CubeMap cubeMap)
+int ggx_distribution::testGeometryTerm(RTCScene & scene, std::vector<Surface *> & surfaces, Camera & camera, CubeMap cubeMap, CubeMap specularCubeMap, Vector3 lightDir, int SamplesCount, Vector3 baseColor, float ior, float roughness, float metallic, std::string nameColor)
 {
+	cv::Mat src_8uc3_img(camera.height(), camera.width(), CV_32FC3);
 
-	cv::Mat src_8uc3_img(480, 640, CV_32FC3);
-	float roughness = 0.5f;
-
-	int SamplesCount = 100;
-	std::string str = "testSamplingOnSphere roughness(" + std::to_string(roughness) + ")";
+	std::string str;
 
+	str = nameColor + "_" + std::to_string(SamplesCount) + " metallic_" + std::to_string(metallic) + " roughness_" + std::to_string(roughness) + " " + "ior_" + std::to_string(ior);
 
-	for (int x = 0; x < 640; x++)
-	{
-#pragma omp parallel for schedule(dynamic, 5) shared(scene, surfaces, src_8uc3_img, camera)
-		for (int y = 0; y < 480; y++)
-		{
 
-			Ray rtc_ray = camera.GenerateRay(x, y);
+	if (preview != NULL) preview->Show(str, src_8uc3_img);
 
-			//Vector3 re = phongRecursion(0, rtc_ray, Vector3(lightPosition[0], lightPosition[1], lightPosition[2]), camera.view_from(), scene, surfaces, cubeMap);
+	lightDir.Normalize();
 
+	RenderTiles(camera, src_8uc3_img, [&](const int x, const int y, Ray & rtc_ray) -> cv::Vec3f
+	{
+		if (rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID)
+		{
+			Vector3 ret;
+			Surface * surface = surfaces[rtc_ray.geomID];
 
+			Vector3 normal = surface->normal(rtc_ray.primID, rtc_ray.u, rtc_ray.v);
 
+			normal = normal.DotProduct(rtc_ray.dir) < 0 ? normal : -normal;
+			normal.Normalize();
 
-			rtcIntersect(scene, rtc_ray);
+			float geom = 0;
 
+			Vector3 reflectionVector = reflect(normal, -lightDir);
+			reflectionVector.Normalize();
 
+			Sampler sampler(seed, sampler_type);
+			sampler.StartPixel(x, y);
 
-			if (rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID)
+			for (int i = 0; i < SamplesCount; i++)
 			{
+				sampler.StartSample(i);
 
+				Vector3 sampleVector = GenerateGGXsampleVector(roughness, sampler);
+				sampleVector.Normalize();
+				sampleVector = TransformToWS(reflectionVector, sampleVector);
 
-				Vector3 ret;
-				Surface * surface = surfaces[rtc_ray.geomID];
-				Triangle & triangle = surface->get_triangle(rtc_ray.primID);
+				Vector3 halfVector = sampleVector - normal;
+				halfVector.Normalize();
 
-				Vector3 normal = triangle.normal(rtc_ray.u, rtc_ray.v);
-
-				Vector3 rayDir = Vector3(rtc_ray.dir);
-				rayDir.Normalize();
+				geom += GGX_PartialGeometryTerm(lightDir, normal, halfVector, roughness) * GGX_PartialGeometryTerm(sampleVector, normal, halfVector, roughness);
+			}
 
+			geom /= SamplesCount;
+			ret = Vector3(geom, geom, geom);
 
+			return cv::Vec3f(ret.z, ret.y, ret.x);
+		}
+		else
+		{
+			Color4 col = Color4(0.5f, 0.5f, 0.5f, 1.0f); //cubeMap.GetTexel(Vector3(rtc_ray.dir));
+			return cv::Vec3f(col.b, col.g, col.r);
+		}
+	});
 
-				normal = normal.DotProduct(rayDir) < 0 ? normal : -normal;
-				normal.Normalize();
+	if (preview != NULL) preview->Finish();
 
-				/*normal += Vector3(1, 1, 1);
-				normal *= 0.5;
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(normal.z, normal.y, normal.x);
-				continue;
-				*/
-				Vector3 reflectionVector = reflect(normal, rayDir);
+	SaveResult(src_8uc3_img, str);
+	//cvSaveImage("D:\\" + str + ".jpg", src_8uc3_img);
+	//cvWaitKey(0);
+	//std::string str = "GGX_Distribution metallic(" + std::to_string(metallic) + ")  roughness(" + std::to_string(roughness) + ")";
 
-				//reflectionVector += Vector3(1, 1, 1);
-				//reflectionVector *= 0.5;
 
-				//src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(reflectionVector.z, reflectionVector.y, reflectionVector.x);
-				//continue;
+	return 0;
+}
 
-				Vector3 irradiance = Vector3(0, 0, 0);
 
-				for (int i = 0; i < SamplesCount; i++)
-				{
-					// Generate a sample vector in some local space
-					Vector3 sampleVector = GenerateGGXsampleVector(roughness);
-					//sampleVector = Vector3(0,0,1);
-					////
-					sampleVector.Normalize();
-					////// Convert the vector in world space
-					sampleVector = TransformToWS(normal, sampleVector);// worldFrame * sampleVector;
-					sampleVector.Normalize();
+int ggx_distribution::testSamplingOnSphere(RTCScene & scene, std::vector<Surface *> & surfaces, Camera & camera, cv::Vec3f lightPosition, CubeMap cubeMap)
+{
 
+	cv::Mat src_8uc3_img(camera.height(), camera.width(), CV_32FC3);
+	float roughness = 0.5f;
 
+	int SamplesCount = 100;
+	std::string str = "testSamplingOnSphere roughness(" + std::to_string(roughness) + ")";
 
-					irradiance += Vector3(cubeMap.GetTexel(sampleVector).data);
-				}
+	if (preview != NULL) preview->Show(str, src_8uc3_img);
 
-				irradiance = irradiance / SamplesCount;
+	RenderTiles(camera, src_8uc3_img, [&](const int x, const int y, Ray & rtc_ray) -> cv::Vec3f
+	{
+		if (rtc_ray.geomID != RTC_INVALID_GEOMETRY_ID)
+		{
+			Vector3 ret;
+			Surface * surface = surfaces[rtc_ray.geomID];
 
-				ret = Vector3(irradiance);
+			Vector3 normal = surface->normal(rtc_ray.primID, rtc_ray.u, rtc_ray.v);
 
-				/*ret += Vector3(1, 1, 1);
-				ret *= 0.5;*/
+			Vector3 rayDir = Vector3(rtc_ray.dir);
+			rayDir.Normalize();
 
+			normal = normal.DotProduct(rayDir) < 0 ? normal : -normal;
+			normal.Normalize();
 
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(ret.z, ret.y, ret.x);
+			Vector3 reflectionVector = reflect(normal, rayDir);
 
-				//kd * diffuse + ks * specular
+			Vector3 irradiance = Vector3(0, 0, 0);
 
+			Sampler sampler(seed, sampler_type);
+			sampler.StartPixel(x, y);
 
+			Vector3 samples[GGX_BATCH_SIZE];
 
-			}
-			else
+			for (int i = 0; i < SamplesCount; i++)
 			{
-				Color4 col = cubeMap.GetTexel(Vector3(rtc_ray.dir)); //Color4(0, 0, 0, 0); //
-				src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(col.b, col.g, col.r);
-
-			}
+				// Generate sample vectors in some local space
+				if (i % GGX_BATCH_SIZE == 0)
+				{
+					GenerateGGXsampleVectors(roughness, sampler, i, MIN(GGX_BATCH_SIZE, SamplesCount - i), samples);
+				}
 
+				Vector3 sampleVector = samples[i % GGX_BATCH_SIZE];
+				////// Convert the vector in world space
+				sampleVector = TransformToWS(normal, sampleVector);// worldFrame * sampleVector;
+				sampleVector.Normalize();
 
+				irradiance += Vector3(cubeMap.GetTexel(sampleVector).data);
+			}
 
-			/*src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(re.z, re.y, re.x);*/
+			irradiance = irradiance / SamplesCount;
 
+			ret = Vector3(irradiance);
 
+			return cv::Vec3f(ret.z, ret.y, ret.x);
 		}
+		else
+		{
+			Color4 col = cubeMap.GetTexel(Vector3(rtc_ray.dir)); //Color4(0, 0, 0, 0); //
+			return cv::Vec3f(col.b, col.g, col.r);
+		}
+	});
 
-		cv::imshow(str, src_8uc3_img); // display image
-
-		cv::moveWindow(str, 10, 50);
-		cvWaitKey(1);
-	}
+	if (preview != NULL) preview->Finish();
 
 	//std::string str = "GGX_Distribution metallic(" + std::to_string(metallic) + ")  roughness(" + std::to_string(roughness) + ")";
 
@@ -540,14 +1296,18 @@ int ggx_distribution::GenerateTestingSamples(float roughness, cv::Vec3b color, c
 			dst_resultTest.at<cv::Vec3b>(y, x) = cv::Vec3b(0, 0, 0);
 		}
 	}
+	Sampler sampler(seed, sampler_type);
+
 	for (int i = 0; i < 500; i++)
 	{
+		sampler.StartSample(i);
+
 
 
 
 
 		//printf("Zacatek Pokus:%d\n", i);
-		Vector3 vec = GenerateGGXsampleVector(roughness);
+		Vector3 vec = GenerateGGXsampleVector(roughness, sampler);
 
 		dst_resultTest.at<cv::Vec3b>(size - (int)(vec.z * size), (int)(vec.x * size)) = color;
 
@@ -555,7 +1315,11 @@ int ggx_distribution::GenerateTestingSamples(float roughness, cv::Vec3b color, c
 		//printf("Pokus:%d   %f, %f, %f\n", i, vec.x, vec.y, vec.z);
 	}
 
-	cv::imshow(name, dst_resultTest);
+	if (preview != NULL)
+	{
+		preview->Show(name, dst_resultTest);
+		preview->Finish();
+	}
 	//cvWaitKey(0);
 	return 1;
 }
@@ -566,9 +1330,45 @@ ggx_distribution::ggx_distribution(RTCScene & _scene, std::vector<Surface *> & _
 {
 	scene = _scene;
 	surfaces = _surfaces;
+	preview = NULL;
+	packet_size = 1;
+	wavefront = false;
+	seed = 0;
+	sampling = GGX_SAMPLING_REFLECTION;
+	sampler_type = SAMPLER_RANDOM;
+	prefiltered = NULL;
+	sh_irradiance = NULL;
+	environment_sampler = NULL;
+	filtered_sampling = false;
+	gbuffer = NULL;
+	denoiser = NULL;
+	stream_tiles = false;
+	stream_format = TILED_IMAGE_FLOAT32;
+	output_dir = "D:\\T4J\\VSB-pg1\\result\\";
+	output_formats = OUTPUT_PNG;
+	output = NULL;
 }
 
-ggx_distribution::ggx_distribution() {}
+ggx_distribution::ggx_distribution()
+{
+	preview = NULL;
+	packet_size = 1;
+	wavefront = false;
+	seed = 0;
+	sampling = GGX_SAMPLING_REFLECTION;
+	sampler_type = SAMPLER_RANDOM;
+	prefiltered = NULL;
+	sh_irradiance = NULL;
+	environment_sampler = NULL;
+	filtered_sampling = false;
+	gbuffer = NULL;
+	denoiser = NULL;
+	stream_tiles = false;
+	stream_format = TILED_IMAGE_FLOAT32;
+	output_dir = "D:\\T4J\\VSB-pg1\\result\\";
+	output_formats = OUTPUT_PNG;
+	output = NULL;
+}
 
 
 ggx_distribution::~ggx_distribution() {}
@@ -3,6 +3,27 @@
 
 #include "camera.h"
 
+#define GGX_BATCH_SIZE 16 // pocet GGX vzorku generovanych najednou
+
+// zpusob generovani smeru v GGX_Specular
+enum GGXSampling
+{
+	GGX_SAMPLING_REFLECTION, // GGX vzorky kolem zrcadloveho smeru
+	GGX_SAMPLING_VNDF // jen mikronormaly viditelne ze smeru pohledu (Heitz 2018)
+};
+
+// adaptivni pocet vzorku na pixel, vzorky se pridavaji po kolech, dokud je interval spolehlivosti sirsi nez threshold
+struct AdaptiveSampling
+{
+	bool enabled;
+	int round_samples; // pocet vzorku jednoho kola
+	int min_rounds; // kola, ktera dostane kazdy pixel (alespon 2, rozptyl se odhaduje z prumeru kol)
+	int max_samples; // strop vzorku na pixel
+	float threshold; // maximalni polovina 95% intervalu spolehlivosti jasu pixelu
+
+	AdaptiveSampling() : enabled(false), round_samples(4), min_rounds(2), max_samples(256), threshold(0.01f) {}
+};
+
 class ggx_distribution
 {
 private:
@@ -12,6 +33,27 @@ public:
 
 	RTCScene scene;
 	std::vector<Surface *> surfaces;
+	Preview * preview; // nahled rozpracovaneho snimku, NULL v bezobrazovkovem rezimu
+	int packet_size; // velikost paketu primarnich paprsku 1 (skalarni), 4, 8 nebo 16
+	bool wavefront; // primarni paprsky po dlazdicich pres rtcIntersectNM a kompakce zasahu (vyzaduje RTC_INTERSECT_STREAM)
+	unsigned int seed; // seed samplovani, nahodna cisla zavisi jen na (seed, pixel, vzorek, dimenze), ne na poctu vlaken
+	GGXSampling sampling; // zpusob generovani smeru v GGX_Specular
+	SamplerType sampler_type; // posloupnost vzorku (nahodna, Sobol, Halton)
+	PrefilteredEnvironment * prefiltered; // split-sum odraz prostredi misto Monte Carlo, NULL = integrovat vzorky
+	SHIrradiance * sh_irradiance; // difuzni ozareni ze SH, NULL = jediny texel cube mapy ve smeru normaly
+	EnvironmentSampler * environment_sampler; // vzorkovani prostredi podle jasu kombinovane s GGX pres MIS, NULL = jen GGX
+	bool filtered_sampling; // vzorky prostredi ctou mip uroven podle sve hustoty a poctu vzorku (vyzaduje CubeMap::BuildMipmaps)
+	AdaptiveSampling adaptive; // adaptivni pocet vzorku v projRenderGGX_Distribution
+	GBuffer * gbuffer; // primarni zasahy sdilene mezi rendery se stejnou kamerou a scenou, NULL = trasovat pokazde
+	Denoiser * denoiser; // a-trous filtr vysledku projRenderGGX_Distribution rizeny normalami, hloubkou a geomID, NULL = bez filtrace
+	bool stream_tiles; // projRenderGGX_Distribution zapisuje hotove dlazdice rovnou do TIFF (libovolne rozliseni, bez nahledu, snimku a denoiseru)
+	TiledImageFormat stream_format; // format vzorku pri stream_tiles
+	Framebuffer framebuffer; // akumulacni framebuffer projRenderGGX_Distribution, pamet se mezi rendery recykluje
+	ResolveSettings resolve; // expozice a tonemapovani pri prevodu do 8 bitu
+	std::string output_dir; // adresar vysledku vcetne koncoveho oddelovace
+	unsigned int output_formats; // kombinace OutputFormat ukladanych snimku
+	OutputSink * output; // zapis obrazu na pozadi, renderer nemusi cekat na kodovani, NULL = zapisovat synchronne
+	std::vector<int> snapshots; // progresivni rezim: vzestupne pocty vzorku, pri kterych se ulozi snimek, prazdne = jediny snimek se SamplesCount
 	/*Camera cameraSPhere;
 	CubeMap cubeMap;*/
 
@@ -52,14 +94,61 @@ public:
 	Vector3 orthogonal(const Vector3 & v);
 	Vector3 TransformToWS(Vector3 normal, Vector3 direction);
 	float Ph(float theta, float phi, float alpha);
-	float GetTheta(float alpha);
-	Vector3 GenerateGGXsampleVector(float roughness);
+	float GetTheta(float alpha, Sampler & sampler);
+	Vector3 GenerateGGXsampleVector(float roughness, Sampler & sampler);
+	// vyplni samples[0..count) vzorky first..first+count-1 aktualniho pixelu, trigonometrie po ctyrech v SSE
+	void GenerateGGXsampleVectors(float roughness, Sampler & sampler, int first, int count, Vector3 * samples);
+
+	float ClampRoughness(float roughness)
+	{
+		return MIN(MAX(roughness, 0.01f), 1.0f);
+	}
 
 
 	Vector3 Fresnel_Schlick(float cosT, Vector3 F0);
 	
 	float GGX_PartialGeometryTerm(Vector3 v, Vector3 n, Vector3 h, float alpha);
-	Vector3 GGX_Specular(CubeMap cubeMapSpecular, Vector3 normal, Vector3 rayDir, float roughness, Vector3 F0, Vector3 * kS, int SamplesCount);
+	// mikronormala z VNDF pro pohled viewLocal v lokalni bazi normaly (z = normala)
+	Vector3 GenerateVNDFsampleVector(const Vector3 & viewLocal, float roughness, Sampler & sampler);
+	float GGX_SmithG1(float NoX, float alpha);
+	Vector3 GGX_SpecularVNDF(CubeMap & cubeMapSpecular, Vector3 normal, Vector3 rayDir, float roughness, Vector3 F0, Vector3 * kS, int SamplesCount, Sampler & sampler, int lodSamplesCount);
+	// split-sum: prefiltrovane prostredi ve smeru odrazu krat (F0 * skala + posun) z tabulky BRDF
+	Vector3 GGX_SpecularPrefiltered(Vector3 normal, Vector3 rayDir, float roughness, Vector3 F0, Vector3 * kS);
+	float GGX_D(float NoH, float alpha);
+	// hustota smeru L pri vzorkovani GGX podle rezimu sampling (vzhledem k prostorovemu uhlu)
+	float GGX_Pdf(float NoV, float NoH, float VoH, float alpha);
+	// MIS (power heuristic) GGX vzorku a vzorku prostredi podle jasu, na kazdy vzorek jeden z kazde strategie
+	Vector3 GGX_SpecularMIS(CubeMap & cubeMapSpecular, Vector3 normal, Vector3 rayDir, float roughness, Vector3 F0, Vector3 * kS, int SamplesCount, Sampler & sampler, int lodSamplesCount);
+	// filtered importance sampling (Colbert, Krivanek 2007): uroven, jejiz texel pokryva prostorovy uhel 1 / (SamplesCount * pdf)
+	float FilteredLod(CubeMap & cubeMap, float pdf, int SamplesCount);
+	// radiance prostredi ve smeru vzorku s hustotou pdf, pri filtered_sampling z odpovidajici mip urovne
+	Vector3 FetchEnvironment(CubeMap & cubeMap, Vector3 & direction, float pdf, int SamplesCount);
+	// lodSamplesCount: celkovy pocet vzorku odhadu pro FilteredLod, 0 = SamplesCount (vzorky po castech pri snimcich a adaptivnim vzorkovani)
+	Vector3 GGX_Specular(CubeMap & cubeMapSpecular, Vector3 normal, Vector3 rayDir, float roughness, Vector3 F0, Vector3 * kS, int SamplesCount, Sampler & sampler, int lodSamplesCount = 0);
+
+	// barva zasahu s normalou normal z SamplesCount vzorku pocinaje sampler.SetFirstSample
+	Vector3 ShadeGGX(CubeMap & cubeMap, CubeMap & specularCubeMap, Vector3 normal, Vector3 lightVector, int SamplesCount, Vector3 baseColor, Vector3 F0, float roughness, float metallic, Sampler & sampler, int lodSamplesCount = 0);
+	// ShadeGGX po kolech podle adaptive, v samplesUsed vrati spotrebovany pocet vzorku
+	Vector3 ShadeAdaptive(CubeMap & cubeMap, CubeMap & specularCubeMap, Vector3 normal, Vector3 lightVector, Vector3 baseColor, Vector3 F0, float roughness, float metallic, Sampler & sampler, int & samplesUsed);
+
+	// zapise obraz pres output (nebo hned, neni-li nastaven), format podle pripony; image se pak uz nesmi menit
+	void WriteImage(const std::string & fileName, const cv::Mat & image);
+	// zapise vrstvy do vicevrstveho OpenEXR pres output
+	void WriteLayers(const std::string & fileName, const std::vector<OutputLayer> & layers);
+	// ulozi float snimek do output_dir + name ve formatech output_formats (PNG po prevodu do 8 bitu)
+	void SaveResult(cv::Mat & image, const std::string & name);
+	// resolve framebufferu a ulozeni do output_dir + name ve formatech output_formats
+	void SaveResult(const Framebuffer & image, const std::string & name);
+	// ulozi snimek a je-li nastaven denoiser, i jeho filtrovanou verzi s priponou " denoised", pri OUTPUT_EXR vse i s features v jednom souboru
+	void SaveDenoised(cv::Mat & image, const FeatureBuffers & features, const std::string & name);
+
+	// varianta materialu s vychozimi hodnotami jako StartRender (-1 = odvodit z barvy)
+	MaterialVariant MakeVariant(GGXColor col, float _ior = -1.0f, float _roughness = -1.0f, float _metallic = -1.0f);
+	// vsechny varianty matice z jedne sady vzorku, colors[i] je barva i-te varianty; fyzikalni GGX odraz
+	// jako ShadeGGX s --vndf/--env-sampling/--prefiltered, ne ladici geometricky clen vychoziho rezimu
+	void ShadeMaterialMatrix(CubeMap & specularCubeMap, const MaterialMatrix & matrix, Vector3 normal, Vector3 lightVector, int SamplesCount, Sampler & sampler, Vector3 * colors);
+	// vykresli vsechny varianty v jednom pruchodu, ulozi obraz kazde varianty a pri sheetColumns > 0 i arch s mrizkou variant
+	int RenderMaterialMatrix(Camera & camera, CubeMap & cubeMap, Vector3 lightDir, int SamplesCount, const MaterialMatrix & matrix, std::string info, int sheetColumns = 0);
 
 	int StartRender(Camera cameraSPhere, CubeMap cubeMap, Vector3 lightDir, int SamplesCount, GGXColor col, std::string info, float _ior = -1.0f, float _roughness = -1.0f, float _metallic = -1.0f);
 
@@ -70,7 +159,164 @@ public:
 	//TESTS
 	int testSamplingOnSphere(RTCScene & scene, std::vector<Surface*>& surfaces, Camera & camera, cv::Vec3f lightPosition, CubeMap cubeMap);
 	int GenerateTestingSamples(float roughness, cv::Vec3b color, char * name);
-	
+
+	// vrhne primarni paprsky bloku 4x4 pixelu, rays[(y - by) * 4 + (x - bx)], pakety podle packet_size
+	void TraceBlock(Camera & camera, const int bx, const int by, const int width, const int height, Ray * rays);
+
+	// vykresli cely snimek po dlazdicich v jedine paralelni oblasti, shader(x, y, ray) vraci BGR barvu pixelu
+	template<class Shader> void RenderTiles(Camera & camera, cv::Mat & image, Shader shader)
+	{
+		TraceTiles(camera, image.cols, image.rows, [&](const int x, const int y, Ray & ray)
+		{
+			image.at<cv::Vec3f>(y, x) = shader(x, y, ray);
+		});
+	}
+
+	// RenderTiles do akumulacniho framebufferu, kazdy pixel s vahou 1
+	template<class Shader> void RenderTiles(Camera & camera, Framebuffer & target, Shader shader)
+	{
+		TraceTiles(camera, target.width(), target.height(), [&](const int x, const int y, Ray & ray)
+		{
+			target.Set(x, y, shader(x, y, ray));
+		});
+	}
+
+	// vrhne primarni paprsky vsech pixelu po dlazdicich, visitor(x, y, ray) dostane kazdy paprsek po pruseciku
+	template<class Visitor> void TraceTiles(Camera & camera, const int width, const int height, Visitor visitor)
+	{
+		TraceTiles(camera, width, height, visitor, [](const Tile & tile, const int thread_id) {});
+	}
+
+	// TraceTiles, po zpracovani vsech pixelu dlazdice se navic zavola done(tile, thread_id)
+	template<class Visitor, class TileDone> void TraceTiles(Camera & camera, const int width, const int height, Visitor visitor, TileDone done)
+	{
+		TileScheduler scheduler(width, height);
+
+		if (wavefront)
+		{
+			TraceWavefront(scheduler, camera, width, height, visitor, done);
+			return;
+		}
+
+		scheduler.Run([&](const Tile & tile, const int thread_id)
+		{
+			Ray rays[16];
+
+			// bloky 4x4 uvnitr dlazdice jdou po radcich, pixely bloku v poradi Hilbertovy krivky (scanline_hilbert_4x4)
+			for (int by = tile.y0; by < tile.y1; by += 4)
+			{
+				for (int bx = tile.x0; bx < tile.x1; bx += 4)
+				{
+					TraceBlock(camera, bx, by, width, height, rays);
+
+					for (int i = 0; i < 16; i++)
+					{
+						const int x = bx + Camera::scanline_hilbert_4x4[2 * i];
+						const int y = by + Camera::scanline_hilbert_4x4[2 * i + 1];
+
+						if (x < tile.x1 && y < tile.y1)
+						{
+							visitor(x, y, rays[(y - by) * 4 + (x - bx)]);
+						}
+					}
+				}
+			}
+
+			done(tile, thread_id);
+		});
+	}
+
+	// vlnova varianta TraceTiles: generovani paketu, rtcIntersectNM, kompakce a shading fronty zasahu
+	template<class Visitor, class TileDone> void TraceWavefront(TileScheduler & scheduler, Camera & camera, const int width, const int height, Visitor visitor, TileDone done)
+	{
+		Wavefront * wavefronts = new Wavefront[omp_get_max_threads()];
+
+		scheduler.Run([&](const Tile & tile, const int thread_id)
+		{
+			Wavefront & stage = wavefronts[thread_id];
+			stage.Trace(scene, camera, tile, width, height);
+
+			std::vector<ShadingItem> & misses = stage.misses();
+
+			for (int i = 0; i < static_cast<int>(misses.size()); i++)
+			{
+				visitor(misses[i].x, misses[i].y, misses[i].ray);
+			}
+
+			std::vector<ShadingItem> & hits = stage.hits();
+
+			for (int i = 0; i < static_cast<int>(hits.size()); i++)
+			{
+				visitor(hits[i].x, hits[i].y, hits[i].ray);
+			}
+
+			done(tile, thread_id);
+		});
+
+		SAFE_DELETE_ARRAY(wavefronts);
+	}
+
+	// vykresli snimek velikosti kamery po dlazdicich rovnou do writer, v pameti jsou jen dlazdice rozpracovane vlakny
+	template<class Shader> void StreamTiles(Camera & camera, TiledImageWriter & writer, Shader shader)
+	{
+		std::vector<cv::Mat> tiles(omp_get_max_threads());
+
+		for (int i = 0; i < static_cast<int>(tiles.size()); i++)
+		{
+			tiles[i] = cv::Mat::zeros(TILE_SIZE, TILE_SIZE, CV_32FC3);
+		}
+
+		// dlazdice planovace lezi v mrizce TILE_SIZE, pozice v dlazdici je tedy x % TILE_SIZE
+		TraceTiles(camera, camera.width(), camera.height(), [&](const int x, const int y, Ray & ray)
+		{
+			tiles[omp_get_thread_num()].at<cv::Vec3f>(y % TILE_SIZE, x % TILE_SIZE) = shader(x, y, ray);
+		},
+		[&](const Tile & tile, const int thread_id)
+		{
+			writer.WriteTile(tile, tiles[thread_id]);
+		});
+	}
+
+	// ShadeTiles do akumulacniho framebufferu, dlazdice planovace odpovidaji dlazdicim framebufferu
+	template<class Shader> void ShadeTiles(Framebuffer & target, Shader shader)
+	{
+		TileScheduler scheduler(target.width(), target.height());
+
+		scheduler.Run([&](const Tile & tile, const int thread_id)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					target.Set(x, y, shader(x, y, gbuffer->index(x, y)));
+				}
+			}
+		});
+	}
+
+	// stinovaci normala zasahu paprsku ray otocena k pozorovateli
+	Vector3 ShadingNormal(const Ray & ray);
+
+	// naplni gbuffer primarnimi paprsky kamery, pokud uz neodpovida kamere a scene; false = gbuffer se nepouzije
+	bool PrepareGBuffer(Camera & camera, const int width, const int height);
+
+	// vykresli snimek z naplneneho gbufferu bez pruseciku se scenou, shader(x, y, i) dostane index pixelu v gbufferu
+	template<class Shader> void ShadeTiles(cv::Mat & image, Shader shader)
+	{
+		TileScheduler scheduler(image.cols, image.rows);
+
+		scheduler.Run([&](const Tile & tile, const int thread_id)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					image.at<cv::Vec3f>(y, x) = shader(x, y, gbuffer->index(x, y));
+				}
+			}
+		});
+	}
+
 	ggx_distribution();
 	ggx_distribution(RTCScene & scene, std::vector<Surface *> & surfaces);
 	~ggx_distribution();
@@ -0,0 +1,175 @@
+#include "stdafx.h"
+
+MaterialMatrix::MaterialMatrix()
+{
+	for ( int i = 0; i < MATERIAL_MATRIX_MAX_VARIANTS; ++i )
+	{
+		alpha2_[i] = 1;
+		f0_[0][i] = f0_[1][i] = f0_[2][i] = 0;
+		mask_[i] = 0;
+	}
+}
+
+int MaterialMatrix::Add( const MaterialVariant & variant )
+{
+	const int i = size();
+
+	if ( i >= MATERIAL_MATRIX_MAX_VARIANTS )
+	{
+		printf( "Material matrix is full, variant %s skipped.\n", variant.name.c_str() );
+
+		return -1;
+	}
+
+	variants_.push_back( variant );
+
+	const float alpha = MIN( MAX( variant.roughness, 0.01f ), 1.0f );
+	alpha2_[i] = SQR( alpha );
+
+	// stejne F0 jako v ggx_distribution::projRenderGGX_Distribution
+	const float ior = variant.ior;
+	const float f0 = SQR( MIN( MAX( ( 1.0f - ior ) / ( 1.0f + ior ), 0.0f ), 1.0f ) );
+
+	f0_[0][i] = ( 1 - variant.metallic ) * f0 + variant.metallic * variant.base_color.x;
+	f0_[1][i] = ( 1 - variant.metallic ) * f0 + variant.metallic * variant.base_color.y;
+	f0_[2][i] = ( 1 - variant.metallic ) * f0 + variant.metallic * variant.base_color.z;
+	mask_[i] = 1;
+
+	return i;
+}
+
+int MaterialMatrix::size() const
+{
+	return static_cast<int>( variants_.size() );
+}
+
+int MaterialMatrix::padded_size() const
+{
+	return ( size() + 3 ) & ~3;
+}
+
+const MaterialVariant & MaterialMatrix::variant( const int i ) const
+{
+	return variants_[i];
+}
+
+float MaterialMatrix::alpha( const int i ) const
+{
+	return sqrt( alpha2_[i] );
+}
+
+Vector3 MaterialMatrix::f0( const int i ) const
+{
+	return Vector3( f0_[0][i], f0_[1][i], f0_[2][i] );
+}
+
+// GGX D(H) pro ctyri varianty
+static inline __m128 GGX_D4( const __m128 alpha2, const float NoH )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 t = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( SQR( NoH ) ), _mm_sub_ps( alpha2, one ) ), one );
+
+	return _mm_div_ps( alpha2, _mm_mul_ps( _mm_set1_ps( static_cast<float>( M_PI ) ), _mm_mul_ps( t, t ) ) );
+}
+
+// Smithuv maskovaci clen G1 pro ctyri varianty, tan2 = tan^2 uhlu mezi normalou a smerem
+static inline __m128 GGX_SmithG14( const __m128 alpha2, const float tan2 )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	return _mm_div_ps( _mm_set1_ps( 2.0f ), _mm_add_ps( one, _mm_sqrt_ps( _mm_add_ps( one, _mm_mul_ps( alpha2, _mm_set1_ps( tan2 ) ) ) ) ) );
+}
+
+static inline float Tan2( const float NoX )
+{
+	const float cos2 = SQR( NoX );
+
+	return ( 1 - cos2 ) / MAX( cos2, 1e-6f );
+}
+
+float MaterialMatrix::Pdf( const float NoV, const float NoH, const float VoH, const bool vndf, float * pdf ) const
+{
+	const int n = padded_size();
+	const float tan2V = Tan2( NoV );
+
+	__m128 sum = _mm_setzero_ps();
+
+	for ( int i = 0; i < n; i += 4 )
+	{
+		const __m128 alpha2 = _mm_load_ps( alpha2_ + i );
+		const __m128 d = GGX_D4( alpha2, NoH );
+
+		// stejne hustoty jako ggx_distribution::GGX_Pdf
+		__m128 p = vndf ?
+			_mm_mul_ps( _mm_mul_ps( GGX_SmithG14( alpha2, tan2V ), d ), _mm_set1_ps( 1.0f / ( 4 * NoV ) ) ) :
+			_mm_mul_ps( d, _mm_set1_ps( NoH / ( 4 * VoH ) ) );
+
+		p = _mm_mul_ps( p, _mm_load_ps( mask_ + i ) );
+
+		_mm_storeu_ps( pdf + i, p );
+		sum = _mm_add_ps( sum, p );
+	}
+
+	RTCORE_ALIGN( 16 ) float lanes[4];
+	_mm_store_ps( lanes, sum );
+
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+void MaterialMatrix::Accumulate( const float NoV, const float NoL, const float NoH, const float VoH, const Vector3 & radiance,
+	float * r, float * g, float * b, float * kr, float * kg, float * kb ) const
+{
+	const int n = padded_size();
+	const float tan2V = Tan2( NoV );
+	const float tan2L = Tan2( NoL );
+
+	// Schlick: F0 + (1 - F0) (1 - VoH)^5, mocnina je pro vsechny varianty stejna
+	const float c = 1 - MIN( MAX( VoH, 0.0f ), 1.0f );
+	const __m128 fc = _mm_set1_ps( SQR( SQR( c ) ) * c );
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	for ( int i = 0; i < n; i += 4 )
+	{
+		const __m128 alpha2 = _mm_load_ps( alpha2_ + i );
+
+		// f * NoL = F D G1(V) G1(L) / (4 NoV)
+		const __m128 brdf = _mm_mul_ps( _mm_mul_ps( GGX_D4( alpha2, NoH ), _mm_mul_ps( GGX_SmithG14( alpha2, tan2V ), GGX_SmithG14( alpha2, tan2L ) ) ),
+			_mm_set1_ps( 1.0f / ( 4 * NoV ) ) );
+
+		__m128 f0 = _mm_load_ps( f0_[0] + i );
+		__m128 f = _mm_add_ps( f0, _mm_mul_ps( _mm_sub_ps( one, f0 ), fc ) );
+		_mm_storeu_ps( r + i, _mm_add_ps( _mm_loadu_ps( r + i ), _mm_mul_ps( f, _mm_mul_ps( brdf, _mm_set1_ps( radiance.x ) ) ) ) );
+		_mm_storeu_ps( kr + i, _mm_add_ps( _mm_loadu_ps( kr + i ), f ) );
+
+		f0 = _mm_load_ps( f0_[1] + i );
+		f = _mm_add_ps( f0, _mm_mul_ps( _mm_sub_ps( one, f0 ), fc ) );
+		_mm_storeu_ps( g + i, _mm_add_ps( _mm_loadu_ps( g + i ), _mm_mul_ps( f, _mm_mul_ps( brdf, _mm_set1_ps( radiance.y ) ) ) ) );
+		_mm_storeu_ps( kg + i, _mm_add_ps( _mm_loadu_ps( kg + i ), f ) );
+
+		f0 = _mm_load_ps( f0_[2] + i );
+		f = _mm_add_ps( f0, _mm_mul_ps( _mm_sub_ps( one, f0 ), fc ) );
+		_mm_storeu_ps( b + i, _mm_add_ps( _mm_loadu_ps( b + i ), _mm_mul_ps( f, _mm_mul_ps( brdf, _mm_set1_ps( radiance.z ) ) ) ) );
+		_mm_storeu_ps( kb + i, _mm_add_ps( _mm_loadu_ps( kb + i ), f ) );
+	}
+}
+
+void MaterialMatrix::AccumulateFresnel( const float VoH, float * kr, float * kg, float * kb ) const
+{
+	const int n = padded_size();
+
+	const float c = 1 - MIN( MAX( VoH, 0.0f ), 1.0f );
+	const __m128 fc = _mm_set1_ps( SQR( SQR( c ) ) * c );
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	float * k[3] = { kr, kg, kb };
+
+	for ( int j = 0; j < 3; ++j )
+	{
+		for ( int i = 0; i < n; i += 4 )
+		{
+			const __m128 f0 = _mm_load_ps( f0_[j] + i );
+			const __m128 f = _mm_add_ps( f0, _mm_mul_ps( _mm_sub_ps( one, f0 ), fc ) );
+			_mm_storeu_ps( k[j] + i, _mm_add_ps( _mm_loadu_ps( k[j] + i ), f ) );
+		}
+	}
+}
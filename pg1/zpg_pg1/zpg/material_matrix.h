@@ -0,0 +1,84 @@
+#ifndef MATERIAL_MATRIX_H_
+#define MATERIAL_MATRIX_H_
+
+#define MATERIAL_MATRIX_MAX_VARIANTS 64 // strop poctu variant, nasobek 4
+
+/*! \struct MaterialVariant
+\brief Jedna varianta materialu v matici (kontaktnim archu).
+*/
+struct MaterialVariant
+{
+	std::string name; /*!< Nazev do jmena vystupniho souboru. */
+	Vector3 base_color; /*!< Zakladni barva. */
+	float ior; /*!< Index lomu. */
+	float roughness; /*!< Drsnost. */
+	float metallic; /*!< Kovovost. */
+};
+
+/*! \class MaterialMatrix
+\brief Sada variant GGX materialu stinovana v jednom pruchodu.
+
+Parametry variant jsou ulozeny po slozkach (SoA) doplnenych na nasobek ctyr,
+takze hustota GGX i hodnota BRDF se pro sdileny smer vzorku pocitaji
+v SSE pro ctyri varianty najednou. Doplnene drahy maji nulovou masku a do
+smesi hustot neprispivaji.
+*/
+class MaterialMatrix
+{
+public:
+	//! Vychozi konstruktor, prazdna matice.
+	MaterialMatrix();
+
+	//! Prida variantu, F0 se odvodi z \a ior, zakladni barvy a kovovosti.
+	/*!
+	\return Index varianty, -1 pokud je matice plna.
+	*/
+	int Add( const MaterialVariant & variant );
+
+	//! Pocet variant.
+	int size() const;
+
+	//! Pocet variant doplneny na nasobek 4.
+	int padded_size() const;
+
+	//! I-ta varianta.
+	const MaterialVariant & variant( const int i ) const;
+
+	//! Drsnost (alpha) i-te varianty po oriznuti do <0.01, 1>.
+	float alpha( const int i ) const;
+
+	//! Odrazivost pri kolmem dopadu i-te varianty.
+	Vector3 f0( const int i ) const;
+
+	//! Hustoty GGX vzorkovani sdileneho smeru pro vsechny varianty, vraci jejich soucet.
+	/*!
+	\param vndf true pro vzorkovani viditelnych mikronormal, jinak D(H) cos(H).
+	\param pdf vystupni pole padded_size() hustot vzhledem k prostorovemu uhlu.
+	*/
+	float Pdf( const float NoV, const float NoH, const float VoH, const bool vndf, float * pdf ) const;
+
+	//! Pricte prispevek sdileneho vzorku ke vsem variantam.
+	/*!
+	Pro kazdou variantu pricte radiance * F * D * G1(V) * G1(L) / (4 NoV) do
+	\a r, \a g, \a b a Fresnel do \a kr, \a kg, \a kb (pole padded_size()).
+
+	\param radiance radiance prostredi vydelena hustotou vzorku.
+	*/
+	void Accumulate( const float NoV, const float NoL, const float NoH, const float VoH, const Vector3 & radiance,
+		float * r, float * g, float * b, float * kr, float * kg, float * kb ) const;
+
+	//! Pricte jen Fresnel vzorku, ktery do odhadu BRDF neprispiva (pod horizontem), do \a kr, \a kg, \a kb.
+	/*!
+	Stejne jako GGX_Specular se Fresnel pocita pro kazdy vzorek, aby se ks i odraz delily stejnym poctem vzorku.
+	*/
+	void AccumulateFresnel( const float VoH, float * kr, float * kg, float * kb ) const;
+
+private:
+	std::vector<MaterialVariant> variants_; /*!< Varianty v poradi pridani. */
+
+	RTCORE_ALIGN( 16 ) float alpha2_[MATERIAL_MATRIX_MAX_VARIANTS]; /*!< Ctverec alpha. */
+	RTCORE_ALIGN( 16 ) float f0_[3][MATERIAL_MATRIX_MAX_VARIANTS]; /*!< Slozky F0. */
+	RTCORE_ALIGN( 16 ) float mask_[MATERIAL_MATRIX_MAX_VARIANTS]; /*!< 1 pro platnou variantu, 0 pro doplnek. */
+};
+
+#endif
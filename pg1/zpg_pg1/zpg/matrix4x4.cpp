@@ -99,6 +99,11 @@ float * Matrix4x4::data()
 	return &data_[0];
 }
 
+const float * Matrix4x4::data() const
+{
+	return &data_[0];
+}
+
 Matrix4x4 operator*( const Matrix4x4 & a, const Matrix4x4 & b )
 {
 	return Matrix4x4( a.m00_ * b.m00_ + a.m01_ * b.m10_ + a.m02_ * b.m20_ + a.m03_ * b.m30_,
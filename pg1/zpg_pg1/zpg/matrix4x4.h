@@ -55,6 +55,12 @@ public:
 	*/
 	float * data();
 
+	//! Ukazatel na prvky matice pouze pro cteni.
+	/*!
+	\return Ukazatel na prvky matice.
+	*/
+	const float * data() const;
+
 	friend Matrix4x4 operator*( const Matrix4x4 & a, const Matrix4x4 & b );
 	friend Vector3 operator*( const Matrix4x4 & a, const Vector3 & b );
 	friend Vector3 operator*( const Matrix4x4 & a, const Vector4 & b );
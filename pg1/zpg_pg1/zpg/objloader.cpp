@@ -5,22 +5,6 @@ http://en.wikipedia.org/wiki/Wavefront_.obj_file
 
 #include "stdafx.h"
 
-bool MaterialExists( std::vector<Material *> & materials, char * material_name )
-{
-	for ( std::vector<Material *>::const_iterator iter = materials.begin();
-		iter != materials.end(); ++iter )
-	{
-		Material * material = *iter;
-
-		if ( material->get_name().compare( material_name ) == 0 )
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
 Texture * TextureProxy(const std::string & full_name, std::map<std::string, Texture*> & already_loaded_textures,
 	const int flip = -1, const bool single_channel = false )
 {
@@ -39,9 +23,154 @@ Texture * TextureProxy(const std::string & full_name, std::map<std::string, Text
 	return texture;
 }
 
+// --- parsovn bez sscanf a nezvisle na locale ---
+
+static inline bool IsBlank( const char c )
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool IsDigit( const char c )
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline const char * SkipBlanks( const char * p )
+{
+	while ( IsBlank( *p ) )
+	{
+		++p;
+	}
+
+	return p;
+}
+
+// klov slovo na zatku dku nsledovan mezerou nebo koncem dku
+static inline bool IsKeyword( const char * p, const char * keyword, const size_t length )
+{
+	return strncmp( p, keyword, length ) == 0 && ( IsBlank( p[length] ) || p[length] == '\n' || p[length] == 0 );
+}
+
+// dal slovo dku (jako sscanf %s), p se posune za nj
+static std::string ParseName( const char * & p )
+{
+	p = SkipBlanks( p );
+	const char * begin = p;
+
+	while ( *p != 0 && *p != '\n' && !IsBlank( *p ) )
+	{
+		++p;
+	}
+
+	return std::string( begin, p );
+}
+
+static int ParseInt( const char * & p )
+{
+	p = SkipBlanks( p );
+
+	const bool negative = ( *p == '-' );
+	if ( *p == '-' || *p == '+' )
+	{
+		++p;
+	}
+
+	int value = 0;
+	for ( ; IsDigit( *p ); ++p )
+	{
+		value = value * 10 + ( *p - '0' );
+	}
+
+	return negative ? -value : value;
+}
+
+// destkov zpis [+-]slice[.slice][(e|E)[+-]slice], nejve 19 platnch slic
+static float ParseFloat( const char * & p )
+{
+	static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	p = SkipBlanks( p );
+
+	const bool negative = ( *p == '-' );
+	if ( *p == '-' || *p == '+' )
+	{
+		++p;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+
+	for ( ; IsDigit( *p ); ++p )
+	{
+		if ( digits < 19 )
+		{
+			mantissa = mantissa * 10 + ( *p - '0' );
+			if ( mantissa > 0 ) ++digits;
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+
+	if ( *p == '.' )
+	{
+		for ( ++p; IsDigit( *p ); ++p )
+		{
+			if ( digits < 19 )
+			{
+				mantissa = mantissa * 10 + ( *p - '0' );
+				if ( mantissa > 0 ) ++digits;
+				--exponent;
+			}
+		}
+	}
+
+	if ( *p == 'e' || *p == 'E' )
+	{
+		++p;
+
+		const bool negative_exponent = ( *p == '-' );
+		if ( *p == '-' || *p == '+' )
+		{
+			++p;
+		}
+
+		int e = 0;
+		for ( ; IsDigit( *p ); ++p )
+		{
+			if ( e < 10000 ) e = e * 10 + ( *p - '0' );
+		}
+
+		exponent += negative_exponent ? -e : e;
+	}
+
+	double value = static_cast<double>( mantissa );
+
+	if ( mantissa != 0 )
+	{
+		for ( ; exponent > 22; exponent -= 22 )
+		{
+			value *= 1e22;
+		}
+
+		for ( ; exponent < -22; exponent += 22 )
+		{
+			value /= 1e22;
+		}
+
+		value = ( exponent < 0 ) ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+	}
+
+	return static_cast<float>( negative ? -value : value );
+}
+
 /*! \fn LoadMTL( const char * file_name, const char * path, std::vector<Material *> & materials )
 \brief Nate materily z MTL souboru \a file_name.
 Soubor \a file_name se mus nachzet v cest \a path. Naten materily budou vrceny pes pole \a materials.
+Materil se stejnm nzvem jako nkter z ji natench se pesko.
 \param file_name nzev MTL souboru vetn ppony.
 \param path cesta k zadanmu souboru.
 \param materials pole materil, do kterho se budou ukldat naten materily.
@@ -49,7 +178,7 @@ Soubor \a file_name se mus
 int LoadMTL( const char * file_name, const char * path, std::vector<Material *> & materials )
 {
 	// oteven soouboru
-	FILE * file = fopen( file_name, "rt" );
+	FILE * file = fopen( file_name, "rb" );
 	if ( file == NULL )
 	{
 		printf( "File %s not found.\n", file_name );
@@ -60,7 +189,6 @@ int LoadMTL( const char * file_name, const char * path, std::vector<Material *>
 	// naten celho souboru do pamti
 	/*const long long*/size_t file_size = static_cast<size_t>( GetFileSize64( file_name ) );
 	char * buffer = new char[file_size + 1]; // +1 protoe budeme za posledn naten byte dvat NULL
-	char * buffer_backup = new char[file_size + 1];	
 
 	printf( "Loading materials from '%s' (%0.1f KB)...\n", file_name, file_size / 1024.0f );
 
@@ -73,131 +201,364 @@ int LoadMTL( const char * file_name, const char * path, std::vector<Material *>
 
 		fclose( file );
 		file = NULL;
+		SAFE_DELETE_ARRAY( buffer );
 
 		return -1;
-	}	
+	}
 
 	buffer[number_of_items_read] = 0; // zajistme korektn ukonen etzce
 
 	fclose( file ); // ukonme prci se souborem
 	file = NULL;
 
-	memcpy( buffer_backup, buffer, file_size + 1 ); // zloha bufferu
-
 	printf( "Done.\n\n");
 
 	printf( "Parsing mesh data...\n" );
 
-	char material_name[128] = { 0 };
-	char image_file_name[256] = { 0 };
-
-	const char delim[] = "\n";
-	char * line = strtok( buffer, delim );
+	// jmna ji natench materil, pi shod plat prvn
+	std::unordered_map<std::string, Material *> material_names;
+	for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
+	{
+		material_names.insert( std::make_pair( materials[i]->get_name(), materials[i] ) );
+	}
 
 	std::map<std::string, Texture*> already_loaded_textures;
 
 	Material * material = NULL;
+	std::string material_name;
 
 	// --- natn vech materil ---
-	while ( line != NULL )
+	for ( const char * line = buffer; *line != 0; )
 	{
-		if ( line[0] != '#' )
+		const char * p = SkipBlanks( line );
+
+		if ( IsKeyword( p, "newmtl", 6 ) )
+		{
+			p += 6;
+			material_name = ParseName( p );
+
+			material = new Material();
+			material->set_name( material_name.c_str() );
+
+			if ( material_names.insert( std::make_pair( material_name, material ) ).second )
+			{
+				materials.push_back( material );
+				printf( "\r%I64u material(s)\t\t", materials.size() );
+			}
+			else
+			{
+				SAFE_DELETE( material ); // zbytek duplicitnho materilu se pesko
+			}
+		}
+		else if ( material != NULL && *p != '#' )
 		{
-			if ( strstr( line, "newmtl" ) == line )
+			if ( IsKeyword( p, "Ka", 2 ) ) // ambient color of the material
+			{
+				p += 2;
+				material->ambient.x = ParseFloat( p );
+				material->ambient.y = ParseFloat( p );
+				material->ambient.z = ParseFloat( p );
+			}
+			else if ( IsKeyword( p, "Kd", 2 ) ) // diffuse color of the material
 			{
-				if ( material != NULL )
+				p += 2;
+				material->diffuse.x = ParseFloat( p );
+				material->diffuse.y = ParseFloat( p );
+				material->diffuse.z = ParseFloat( p );
+			}
+			else if ( IsKeyword( p, "Ks", 2 ) ) // specular color of the material
+			{
+				p += 2;
+				material->specular.x = ParseFloat( p );
+				material->specular.y = ParseFloat( p );
+				material->specular.z = ParseFloat( p );
+			}
+			else if ( IsKeyword( p, "Ke", 2 ) ) // emission color of the material
+			{
+				p += 2;
+				material->emission.x = ParseFloat( p );
+				material->emission.y = ParseFloat( p );
+				material->emission.z = ParseFloat( p );
+			}
+			else if ( IsKeyword( p, "Ns", 2 ) ) // specular coefficient
+			{
+				p += 2;
+				material->shininess = ParseFloat( p );
+			}
+			else if ( IsKeyword( p, "map_Kd", 6 ) ) // diffuse map
+			{
+				p += 6;
+				std::string full_name = std::string( path ).append( ParseName( p ) );
+				material->set_texture( Material::kDiffuseMapSlot, TextureProxy( full_name, already_loaded_textures ) );
+			}
+			else if ( IsKeyword( p, "map_Ks", 6 ) ) // specular map
+			{
+				p += 6;
+				std::string full_name = std::string( path ).append( ParseName( p ) );
+				material->set_texture( Material::kSpecularMapSlot, TextureProxy( full_name, already_loaded_textures ) );
+			}
+			else if ( IsKeyword( p, "map_bump", 8 ) ) // normal map
+			{
+				p += 8;
+				std::string image_file_name = ParseName( p );
+				if ( image_file_name[0] == '-' ) // volba -bm <mtko>
 				{
-					material->set_name( material_name );
-					if ( !MaterialExists( materials, material_name ) )
-					{
-						materials.push_back( material );
-						printf( "\r%I64u material(s)\t\t", materials.size() );
-					}
+					ParseFloat( p );
+					image_file_name = ParseName( p );
 				}
-				material = NULL;
+				std::string full_name = std::string( path ).append( image_file_name );
+				material->set_texture( Material::kNormalMapSlot, TextureProxy( full_name, already_loaded_textures ) );
+			}
+			else if ( IsKeyword( p, "map_D", 5 ) ) // opacity map
+			{
+				p += 5;
+				std::string full_name = std::string( path ).append( ParseName( p ) );
+				material->set_texture( Material::kOpacityMapSlot, TextureProxy( full_name, already_loaded_textures, -1, true ) );
+			}
+		}
 
-				sscanf( line, "%*s %s", &material_name );
-				//printf( "material name=%s\n", material_name );				
+		// pechod na dal dek
+		const char * next = strchr( line, '\n' );
+		line = ( next != NULL ) ? next + 1 : line + strlen( line );
+	}
 
-				material = new Material();
-			}
-			else
+	SAFE_DELETE_ARRAY( buffer );
+
+	printf( "\n" );
+
+	return 0;
+}
+
+/*! \struct ObjEvent
+\brief Pkaz g nebo usemtl a pozice v poli roh, od kter plat.
+*/
+struct ObjEvent
+{
+	bool group; /*!< true = g, false = usemtl. */
+	std::string name; /*!< Nzev skupiny nebo materilu. */
+	size_t corner; /*!< Poet roh seku ped pkazem. */
+};
+
+/*! \struct ObjChunk
+\brief Vsledek parsovn jednoho seku OBJ souboru.
+
+Indexy roh jsou u 0-based globln. Zporn (relativn) indexy OBJ se
+vztahuj k potu vrchol ped dkem, ten ale sek bez pedchozch sek
+nezn, a proto se ulo relativn k zatku seku a pozice se zape do
+\a relative; pi spojovn se k nim pite poet v pedchozch secch.
+*/
+struct ObjChunk
+{
+	std::vector<Vector3> vertices;
+	std::vector<Vector3> per_vertex_normals;
+	std::vector<Vector2> texture_coords;
+
+	std::vector<int> corners; /*!< Trojice (v, vt, vn) roh trojhelnk, -1 = chyb. */
+	std::vector<size_t> relative; /*!< Pozice v \a corners s indexem relativnm k zatku seku. */
+
+	std::vector<ObjEvent> events; /*!< Pkazy g a usemtl v poad souboru. */
+	std::vector<std::string> material_libraries; /*!< Pkazy mtllib v poad souboru. */
+};
+
+/*! \struct ObjGroup
+\brief Skupina trojhelnk tvoc jednu plochu.
+*/
+struct ObjGroup
+{
+	std::string name;
+	std::string material_name; /*!< Posledn usemtl ped koncem skupiny. */
+	size_t first_corner;
+	size_t last_corner;
+};
+
+// parsovn dk [begin, end) do chunk
+static void ParseObjChunk( const char * begin, const char * end, const bool flip_yz, ObjChunk & chunk )
+{
+	std::vector<int> face; // rohy prv natan face
+	std::vector<char> face_relative; // index rohu face je relativn k zatku seku
+
+	for ( const char * line = begin; line < end; )
+	{
+		const char * next = static_cast<const char *>( memchr( line, '\n', end - line ) );
+		next = ( next != NULL ) ? next + 1 : end;
+
+		const char * p = SkipBlanks( line );
+
+		switch ( p[0] )
+		{
+		case 'v': // seznam vrchol, norml nebo texturovacch souadnic
 			{
-				char * tmp = Trim( line );				
-				if ( strstr( tmp, "Ka" ) == tmp ) // ambient color of the material
+				if ( IsBlank( p[1] ) ) // vertex
 				{
-					sscanf( tmp, "%*s %f %f %f", &material->ambient.x, &material->ambient.y, &material->ambient.z );
+					p += 1;
+					Vector3 vertex;
+					vertex.x = ParseFloat( p );
+					vertex.y = ParseFloat( p );
+					vertex.z = ParseFloat( p );
+
+					if ( flip_yz )
+					{
+						const float y = vertex.y;
+						vertex.y = -vertex.z;
+						vertex.z = y;
+					}
+
+					chunk.vertices.push_back( vertex );
 				}
-				if ( strstr( tmp, "Kd" ) == tmp ) // diffuse color of the material
+				else if ( p[1] == 'n' && IsBlank( p[2] ) ) // normla vertexu
 				{
-					sscanf( tmp, "%*s %f %f %f", &material->diffuse.x, &material->diffuse.y, &material->diffuse.z );
+					p += 2;
+					Vector3 normal;
+					normal.x = ParseFloat( p );
+					normal.y = ParseFloat( p );
+					normal.z = ParseFloat( p );
+
+					if ( flip_yz )
+					{
+						const float y = normal.y;
+						normal.y = -normal.z;
+						normal.z = y;
+					}
+
+					normal.Normalize();
+					chunk.per_vertex_normals.push_back( normal );
 				}
-				if ( strstr( tmp, "Ks" ) == tmp ) // specular color of the material
+				else if ( p[1] == 't' && IsBlank( p[2] ) ) // texturovac souadnice
 				{
-					sscanf( tmp, "%*s %f %f %f", &material->specular.x, &material->specular.y, &material->specular.z );
+					p += 2;
+					Vector2 texture_coord;
+					texture_coord.x = ParseFloat( p );
+					texture_coord.y = ParseFloat( p );
+					chunk.texture_coords.push_back( texture_coord );
 				}
-				if ( strstr( tmp, "Ke" ) == tmp ) // emission color of the material
+			}
+			break;
+
+		case 'f': // face
+			{
+				if ( !IsBlank( p[1] ) )
 				{
-					sscanf( tmp, "%*s %f %f %f", &material->emission.x, &material->emission.y, &material->emission.z );
+					break;
 				}
-				if ( strstr( tmp, "Ns" ) == tmp ) // specular coefficient
+
+				++p;
+				face.clear();
+				face_relative.clear();
+
+				const int counts[3] = { static_cast<int>( chunk.vertices.size() ),
+					static_cast<int>( chunk.texture_coords.size() ), static_cast<int>( chunk.per_vertex_normals.size() ) };
+
+				// rohy v, v/vt, v//vn nebo v/vt/vn
+				for ( p = SkipBlanks( p ); IsDigit( *p ) || *p == '-'; p = SkipBlanks( p ) )
 				{
-					sscanf( tmp, "%*s %f", &material->shininess );
+					int indices[3] = { 0, 0, 0 };
+					indices[0] = ParseInt( p );
+
+					if ( *p == '/' )
+					{
+						++p;
+						if ( *p != '/' ) indices[1] = ParseInt( p );
+
+						if ( *p == '/' )
+						{
+							++p;
+							indices[2] = ParseInt( p );
+						}
+					}
+
+					for ( int k = 0; k < 3; ++k )
+					{
+						face.push_back( ( indices[k] < 0 ) ? counts[k] + indices[k] : indices[k] - 1 );
+						face_relative.push_back( indices[k] < 0 );
+					}
 				}
-				if ( strstr( tmp, "map_Kd" ) == tmp ) // diffuse map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string( path ).append( image_file_name );
-					material->set_texture(Material::kDiffuseMapSlot, TextureProxy( full_name, already_loaded_textures ) );
+
+				// vj trojhelnk, tyhelnk 0 1 2 3 se rozdl na 0 1 2 a 0 2 3 jako dve
+				const int no_corners = static_cast<int>( face.size() ) / 3;
+
+				for ( int i = 1; i + 1 < no_corners; ++i )
+				{
+					const int fan[3] = { 0, i, i + 1 };
+
+					for ( int j = 0; j < 3; ++j )
+					{
+						for ( int k = 0; k < 3; ++k )
+						{
+							const int index = fan[j] * 3 + k;
+
+							if ( face_relative[index] )
+							{
+								chunk.relative.push_back( chunk.corners.size() );
+							}
+
+							chunk.corners.push_back( face[index] );
+						}
+					}
 				}
-				if ( strstr( tmp, "map_Ks" ) == tmp ) // specular map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string( path ).append( image_file_name );
-					material->set_texture( Material::kSpecularMapSlot, TextureProxy( full_name, already_loaded_textures ) );
+			}
+			break;
+
+		case 'g': // group
+			{
+				if ( IsBlank( p[1] ) || p[1] == '\n' || p[1] == 0 )
+				{
+					++p;
+					ObjEvent event = { true, ParseName( p ), chunk.corners.size() };
+					chunk.events.push_back( event );
 				}
-				if ( strstr( tmp, "map_bump" ) == tmp ) // normal map
+			}
+			break;
+
+		case 'u': // usemtl
+			{
+				if ( IsKeyword( p, "usemtl", 6 ) )
 				{
-					float bm = 0;
-					sscanf( tmp, "%*s %*s %f %s", &bm, image_file_name );
-					std::string full_name = std::string(path).append(image_file_name);
-					material->set_texture(Material::kNormalMapSlot, TextureProxy(full_name, already_loaded_textures));
+					p += 6;
+					ObjEvent event = { false, ParseName( p ), chunk.corners.size() };
+					chunk.events.push_back( event );
 				}
-				if ( strstr( tmp, "map_D" ) == tmp ) // opacity map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string(path).append(image_file_name);
-					material->set_texture(Material::kOpacityMapSlot, TextureProxy(full_name, already_loaded_textures, -1, true));
+			}
+			break;
+
+		case 'm': // mtllib
+			{
+				if ( IsKeyword( p, "mtllib", 6 ) )
+				{
+					p += 6;
+					chunk.material_libraries.push_back( ParseName( p ) );
 				}
 			}
+			break;
 		}
 
-		line = strtok( NULL, delim ); // naten dalho dku
+		line = next;
 	}
+}
 
-	if ( material != NULL )
+/*! \struct ObjCornerHash
+\brief Hash trojice index v, vt, vn jednoho rohu trojhelnka.
+*/
+struct ObjCornerHash
+{
+	size_t operator()( const std::array<int, 3> & c ) const
 	{
-		material->set_name( material_name );
-		materials.push_back( material );
-		printf( "\r%I64u material(s)\t\t", materials.size() );
-	}
-	material = NULL;
-
-	//memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
-	SAFE_DELETE_ARRAY( buffer_backup );
-	SAFE_DELETE_ARRAY( buffer );	
-
-	printf( "\n" );
+		// FNV-1a po celch indexech
+		unsigned long long hash = 14695981039346656037ull;
+		for ( int i = 0; i < 3; ++i )
+		{
+			hash = ( hash ^ static_cast<unsigned int>( c[i] ) ) * 1099511628211ull;
+		}
 
-	return 0;
-}
+		return static_cast<size_t>( hash ^ ( hash >> 32 ) );
+	}
+};
 
 int LoadOBJ( const char * file_name, Vector3 & default_color,
 	std::vector<Surface *> & surfaces, std::vector<Material *> & materials,
-	const bool flip_yz )
+	const bool flip_yz, const bool use_cache, const bool indexed )
 {
 	// oteven soouboru
-	FILE * file = fopen( file_name, "rt" );
+	FILE * file = fopen( file_name, "rb" );
 	if ( file == NULL )
 	{
 		printf( "File %s not found.\n", file_name );
@@ -213,10 +574,31 @@ int LoadOBJ( const char * file_name, Vector3 & default_color,
 		memcpy( path, file_name, sizeof( char ) * ( tmp - file_name + 1 ) );
 	}
 
+	// hotov plochy z binrn cache, materily se natou znovu z MTL
+	const std::string cache_name = std::string( file_name ) + ".cache";
+	const int first_surface = static_cast<int>( surfaces.size() );
+
+	if ( use_cache )
+	{
+		SceneCache cache;
+
+		if ( cache.Open( cache_name.c_str(), default_color, flip_yz, indexed ) == 0 )
+		{
+			fclose( file );
+			file = NULL;
+
+			for ( int i = 0; i < static_cast<int>( cache.material_libraries().size() ); ++i )
+			{
+				LoadMTL( cache.material_libraries()[i].c_str(), path, materials );
+			}
+
+			return cache.BuildSurfaces( surfaces, materials );
+		}
+	}
+
 	// naten celho souboru do pamti
 	/*const long long*/size_t file_size = static_cast<size_t>( GetFileSize64( file_name ) );
 	char * buffer = new char[file_size + 1]; // +1 protoe budeme za posledn naten byte dvat NULL
-	char * buffer_backup = new char[file_size + 1];	
 
 	printf( "Loading model from '%s' (%0.1f MB)...\n", file_name, file_size / SQR( 1024.0f ) );
 
@@ -229,6 +611,7 @@ int LoadOBJ( const char * file_name, Vector3 & default_color,
 
 		fclose( file );
 		file = NULL;
+		SAFE_DELETE_ARRAY( buffer );
 
 		return -1;
 	}	
@@ -238,256 +621,258 @@ int LoadOBJ( const char * file_name, Vector3 & default_color,
 	fclose( file ); // ukonme prci se souborem
 	file = NULL;
 
-	memcpy( buffer_backup, buffer, file_size + 1 ); // zloha bufferu
-
 	printf( "Done.\n\n");
 
-	printf( "Parsing material data...\n" );
+	printf( "Parsing mesh data...\n" );
 
-	char material_library[128] = { 0 };
+	const double t0 = omp_get_wtime();
 
-	std::vector<std::string> material_libraries;	
+	// --- rozdlen na seky po celch dcch a paraleln parsovn ---
+	const size_t min_chunk_size = 256 * 1024;
+	const size_t no_chunks = MAX( static_cast<size_t>( 1 ), MIN( number_of_items_read / min_chunk_size, static_cast<size_t>( 4 * omp_get_max_threads() ) ) );
 
-	const char delim[] = "\n";
-	char * line = strtok( buffer, delim );
+	std::vector<const char *> bounds( no_chunks + 1, buffer + number_of_items_read );
+	bounds[0] = buffer;
 
-	// --- natn vech materilovch knihoven, prvn prchod ---
-	while ( line != NULL )
+	for ( size_t i = 1; i < no_chunks; ++i )
 	{
-		switch ( line[0] )
-		{	
-		case 'm': // mtllib
-			{
-				sscanf( line, "%*s %s", &material_library );
-				printf( "Material library: %s\n", material_library );				
-				material_libraries.push_back( std::string( path ).append( std::string( material_library ) ) );
-			}
-			break;
-		}
-
-		line = strtok( NULL, delim ); // naten dalho dku
+		const char * p = MAX( bounds[i - 1], buffer + i * ( number_of_items_read / no_chunks ) );
+		const char * eol = static_cast<const char *>( memchr( p, '\n', buffer + number_of_items_read - p ) );
+		bounds[i] = ( eol != NULL ) ? eol + 1 : buffer + number_of_items_read;
 	}
 
-	memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
+	std::vector<ObjChunk> chunks( no_chunks );
 
-	for ( int i = 0; i < static_cast<int>( material_libraries.size() ); ++i )
-	{		
-		LoadMTL( material_libraries[i].c_str(), path, materials );
+#pragma omp parallel for schedule( dynamic, 1 )
+	for ( int i = 0; i < static_cast<int>( no_chunks ); ++i )
+	{
+		ParseObjChunk( bounds[i], bounds[i + 1], flip_yz, chunks[i] );
 	}
 
-	std::vector<Vector3> vertices; // cel jeden soubor
-	std::vector<Vector3> per_vertex_normals;
-	std::vector<Vector2> texture_coords;	
+	SAFE_DELETE_ARRAY( buffer );
 
-	line = strtok( buffer, delim );	
+	// --- spojen sek v poad souboru ---
+	std::vector<size_t> vertex_offsets( no_chunks + 1, 0 );
+	std::vector<size_t> normal_offsets( no_chunks + 1, 0 );
+	std::vector<size_t> texture_coord_offsets( no_chunks + 1, 0 );
+	std::vector<size_t> corner_offsets( no_chunks + 1, 0 );
 
-	// --- natn vech souadnic, druh prchod ---
-	while ( line != NULL )
+	std::vector<std::string> material_libraries;
+
+	for ( size_t i = 0; i < no_chunks; ++i )
 	{
-		switch ( line[0] )
+		vertex_offsets[i + 1] = vertex_offsets[i] + chunks[i].vertices.size();
+		normal_offsets[i + 1] = normal_offsets[i] + chunks[i].per_vertex_normals.size();
+		texture_coord_offsets[i + 1] = texture_coord_offsets[i] + chunks[i].texture_coords.size();
+		corner_offsets[i + 1] = corner_offsets[i] + chunks[i].corners.size();
+
+		for ( size_t j = 0; j < chunks[i].material_libraries.size(); ++j )
 		{
-		case 'v': // seznam vrchol, norml nebo texturovacch souadnic aktuln skupiny			
-			{
-				switch ( line[1] )
-				{
-				case ' ': // vertex
-					{
-						Vector3 vertex;
-						if ( flip_yz )
-						{
-							//float x, y, z;
-							sscanf( line, "%*s %f %f %f", &vertex.x, &vertex.z, &vertex.y );
-							vertex.y *= -1;
-						}
-						else
-						{
-							sscanf( line, "%*s %f %f %f", &vertex.x, &vertex.y, &vertex.z );
-						}
+			printf( "Material library: %s\n", chunks[i].material_libraries[j].c_str() );
+			material_libraries.push_back( std::string( path ).append( chunks[i].material_libraries[j] ) );
+		}
+	}
 
-						vertices.push_back( vertex );
-					}
-					break;
+	std::vector<Vector3> vertices( vertex_offsets[no_chunks] ); // cel jeden soubor
+	std::vector<Vector3> per_vertex_normals( normal_offsets[no_chunks] );
+	std::vector<Vector2> texture_coords( texture_coord_offsets[no_chunks] );
+	std::vector<int> corners( corner_offsets[no_chunks] );
 
-				case 'n': // normla vertexu
-					{
-						Vector3 normal;
-						if ( flip_yz )
-						{			
-							//float x, y, z;
-							sscanf( line, "%*s %f %f %f", &normal.x, &normal.z, &normal.y );							
-							normal.y *= -1;
-						}
-						else
-						{
-							sscanf( line, "%*s %f %f %f", &normal.x, &normal.y, &normal.z );
-						}
-						normal.Normalize();
-						per_vertex_normals.push_back( normal );
-					}
-					break;
+#pragma omp parallel for schedule( dynamic, 1 )
+	for ( int i = 0; i < static_cast<int>( no_chunks ); ++i )
+	{
+		ObjChunk & chunk = chunks[i];
 
-				case 't': // texturovac souadnice
-					{
-						Vector2 texture_coord;
-						float z = 0;
-						sscanf( line, "%*s %f %f %f",
-							&texture_coord.x, &texture_coord.y, &z );					
-						texture_coords.push_back( texture_coord );
-					}
-					break;
-				}
-			}
-			break;		
+		std::copy( chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + vertex_offsets[i] );
+		std::copy( chunk.per_vertex_normals.begin(), chunk.per_vertex_normals.end(), per_vertex_normals.begin() + normal_offsets[i] );
+		std::copy( chunk.texture_coords.begin(), chunk.texture_coords.end(), texture_coords.begin() + texture_coord_offsets[i] );
+
+		// relativn indexy vi zatku seku na globln
+		const int bases[3] = { static_cast<int>( vertex_offsets[i] ), static_cast<int>( texture_coord_offsets[i] ), static_cast<int>( normal_offsets[i] ) };
+
+		for ( size_t j = 0; j < chunk.relative.size(); ++j )
+		{
+			chunk.corners[chunk.relative[j]] += bases[chunk.relative[j] % 3];
 		}
 
-		line = strtok( NULL, delim ); // naten dalho dku
-	}
+		std::copy( chunk.corners.begin(), chunk.corners.end(), corners.begin() + corner_offsets[i] );
 
-	memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
+		std::vector<Vector3>().swap( chunk.vertices );
+		std::vector<Vector3>().swap( chunk.per_vertex_normals );
+		std::vector<Vector2>().swap( chunk.texture_coords );
+		std::vector<int>().swap( chunk.corners );
+	}
 
 	printf( "%I64u vertices, %I64u normals and %I64u texture coords.\n",
 		vertices.size(), per_vertex_normals.size(), texture_coords.size() );
 
-	/// buffery pro natn etzc	
-	char group_name[128];	
-	char material_name[128];
-	char vertices_indices[4][8 * 3 + 2];	// pomocn etzec pro natn index a 4 x "v/vt/vn"
-	char vertex_indices[3][8];				// pomocn etzec jednotlivch index "v", "vt" a "vn"	
+	// rohy odkazujc mimo naten pole (chybjc vt a vn jsou -1 a nahrad se nulou)
+	const int limits[3] = { static_cast<int>( vertices.size() ), static_cast<int>( texture_coords.size() ), static_cast<int>( per_vertex_normals.size() ) };
+
+	for ( size_t i = 0; i < corners.size(); ++i )
+	{
+		const int k = static_cast<int>( i % 3 );
 
-	std::vector<Vertex> face_vertices; // pole vech vertex prv natan face
+		if ( corners[i] >= limits[k] || corners[i] < ( ( k == 0 ) ? 0 : -1 ) )
+		{
+			printf( "Triangle %I64u refers to a missing vertex.\n", i / 9 + 1 );
 
-	int no_surfaces = 0; // poet natench ploch
+			return -1;
+		}
+	}
 
-	line = strtok( buffer, delim ); // reset
+	// skupiny: g uzave pedchoz skupinu, materil je posledn usemtl ped koncem skupiny
+	std::vector<ObjGroup> groups;
+	ObjGroup group = { std::string(), std::string(), 0, 0 };
 
-	// --- natn jednotlivch objekt (group), tet prchod ---
-	while ( line != NULL )
+	for ( size_t i = 0; i < no_chunks; ++i )
 	{
-		switch ( line[0] )
+		for ( size_t j = 0; j < chunks[i].events.size(); ++j )
 		{
-		case 'g': // group
+			const ObjEvent & event = chunks[i].events[j];
+
+			if ( event.group )
 			{
-				if ( face_vertices.size() > 0 )
-				{
-					surfaces.push_back( BuildSurface( std::string( group_name ), face_vertices ) );
-					printf( "\r%I64u group(s)\t\t", surfaces.size() );
-					++no_surfaces;
-					face_vertices.clear();
+				group.last_corner = corner_offsets[i] + event.corner;
 
-					for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
-					{
-						if ( materials[i]->get_name().compare( material_name ) == 0 )
-						{
-							Surface * s = *--surfaces.end();
-							s->set_material( materials[i] );
-							break;
-						}
-					}
+				if ( group.last_corner > group.first_corner )
+				{
+					groups.push_back( group );
 				}
 
-				sscanf( line, "%*s %s", &group_name );
-				//printf( "Group name: %s\n", group_name );				
+				group.name = event.name;
+				group.first_corner = group.last_corner;
 			}
-			break;
-
-		case 'u': // usemtl			
+			else
 			{
-				sscanf( line, "%*s %s", &material_name );
-				//printf( "Material name: %s\n", material_name );						
+				group.material_name = event.name;
 			}
-			break;
-
-		case 'f': // face
-			{
-				// ! pedpokldme pouze trojhelnky !
-				// ! pedpokldme vyuit vech t poloek v/vt/vn !				
-				int no_spaces = 0;
-				for ( int i = 0; i < static_cast<int>( strlen( line ) ); ++i )
-				{
-					if ( line[i] == ' ' )
-					{
-						++no_spaces;
-					}
-				}
-				switch ( no_spaces )
-				{
-				case 3: // triangles
-					sscanf( line, "%*s %s %s %s",
-						&vertices_indices[0], &vertices_indices[1], &vertices_indices[2] );
-					break;
+		}
+	}
 
-				case 4: // quadrilaterals				
-					sscanf( line, "%*s %s %s %s %s",
-						&vertices_indices[0], &vertices_indices[1], &vertices_indices[2], &vertices_indices[3] );
-					break;
-				}
+	group.last_corner = corners.size();
 
-				// TODO smoothing groups
+	if ( group.last_corner > group.first_corner )
+	{
+		groups.push_back( group );
+	}
 
-				for ( int i = 0; i < 3; ++i )				
-				{				
-					sscanf( vertices_indices[i], "%[0-9]/%[0-9]/%[0-9]",					
-						&vertex_indices[0], &vertex_indices[1], &vertex_indices[2] );
+	chunks.clear();
 
-					const int vertex_index = atoi( vertex_indices[0] ) - 1;
-					const int texture_coord_index = atoi( vertex_indices[1] ) - 1;
-					const int per_vertex_normal_index = atoi( vertex_indices[2] ) - 1;
+	for ( int i = 0; i < static_cast<int>( material_libraries.size() ); ++i )
+	{		
+		LoadMTL( material_libraries[i].c_str(), path, materials );
+	}
 
-					face_vertices.push_back( Vertex( vertices[vertex_index],
-						per_vertex_normals[per_vertex_normal_index],
-						default_color, &texture_coords[texture_coord_index] ) );
-				}
+	// piazen materil podle nzvu, pi shod plat prvn
+	std::unordered_map<std::string, Material *> material_names;
+	for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
+	{
+		material_names.insert( std::make_pair( materials[i]->get_name(), materials[i] ) );
+	}
 
-				if ( no_spaces == 4 )
-				{
-					const int i[] = { 0, 2, 3 };
-					for ( int j = 0; j < 3; ++j )
-					{				
-						sscanf( vertices_indices[i[j]], "%[0-9]/%[0-9]/%[0-9]",					
-							&vertex_indices[0], &vertex_indices[1], &vertex_indices[2] );
+	// --- sestaven ploch, trojhelnky vech ploch paraleln ---
+	Vector2 no_texture_coord( 0.0f, 0.0f );
+	Vector3 no_normal( 0.0f, 0.0f, 0.0f );
 
-						const int vertex_index = atoi( vertex_indices[0] ) - 1;
-						const int texture_coord_index = atoi( vertex_indices[1] ) - 1;
-						const int per_vertex_normal_index = atoi( vertex_indices[2] ) - 1;
+	for ( size_t i = 0; i < groups.size(); ++i )
+	{
+		Surface * surface = indexed ? new Surface( groups[i].name ) :
+			new Surface( groups[i].name, static_cast<int>( ( groups[i].last_corner - groups[i].first_corner ) / 9 ) );
 
-						face_vertices.push_back( Vertex( vertices[vertex_index],
-							per_vertex_normals[per_vertex_normal_index],
-							default_color, &texture_coords[texture_coord_index] ) );
-					}
-				}
-			}
-			break;
+		std::unordered_map<std::string, Material *>::const_iterator material = material_names.find( groups[i].material_name );
+		if ( material != material_names.end() )
+		{
+			surface->set_material( material->second );
 		}
 
-		line = strtok( NULL, delim ); // naten dalho dku
+		surfaces.push_back( surface );
 	}
 
-	if ( face_vertices.size() > 0 )
+	const int no_triangles = static_cast<int>( corners.size() / 9 );
+
+	if ( indexed )
 	{
-		surfaces.push_back( BuildSurface( std::string( group_name ), face_vertices ) );
-		printf( "\r%I64u group(s)\t\t", surfaces.size() );
-		++no_surfaces;
-		face_vertices.clear();
+		// svaen roh se stejnou trojic v, vt, vn, kad plocha m vlastn vrcholy
+#pragma omp parallel for schedule( dynamic, 1 )
+		for ( int g = 0; g < static_cast<int>( groups.size() ); ++g )
+		{
+			const size_t n = ( groups[g].last_corner - groups[g].first_corner ) / 3;
+
+			std::unordered_map<std::array<int, 3>, unsigned int, ObjCornerHash> welded;
+			welded.reserve( n );
+
+			std::vector<Vector3> positions;
+			std::vector<Vector3> normals;
+			std::vector<Vector2> uvs;
+			std::vector<unsigned int> indices( n );
+
+			for ( size_t i = 0; i < n; ++i )
+			{
+				const int * c = &corners[groups[g].first_corner + i * 3];
+				const std::array<int, 3> key = { { c[0], c[1], c[2] } };
+
+				std::pair<std::unordered_map<std::array<int, 3>, unsigned int, ObjCornerHash>::iterator, bool> vertex =
+					welded.insert( std::make_pair( key, static_cast<unsigned int>( positions.size() ) ) );
+
+				if ( vertex.second )
+				{
+					positions.push_back( vertices[c[0]] );
+					normals.push_back( ( c[2] >= 0 ) ? per_vertex_normals[c[2]] : no_normal );
+					uvs.push_back( ( c[1] >= 0 ) ? texture_coords[c[1]] : no_texture_coord );
+				}
+
+				indices[i] = vertex.first->second;
+			}
 
-		for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
+			surfaces[first_surface + g]->set_indexed_mesh( positions, normals, uvs, indices );
+		}
+	}
+	else
+	{
+#pragma omp parallel for schedule( dynamic, 1024 )
+		for ( int t = 0; t < no_triangles; ++t )
 		{
-			if ( materials[i]->get_name().compare( material_name ) == 0 )
+			// skupina trojhelnku t, skupiny jsou seazen podle first_corner
+			size_t g = std::upper_bound( groups.begin(), groups.end(), static_cast<size_t>( t ) * 9,
+				[]( const size_t corner, const ObjGroup & group ) { return corner < group.first_corner; } ) - groups.begin() - 1;
+
+			Surface * surface = surfaces[first_surface + g];
+			const int * c = &corners[static_cast<size_t>( t ) * 9];
+
+			Vertex face_vertices[3];
+
+			for ( int j = 0; j < 3; ++j, c += 3 )
 			{
-				Surface * s = *--surfaces.end();
-				s->set_material( materials[i] );
-				break;
+				face_vertices[j] = Vertex( vertices[c[0]], ( c[2] >= 0 ) ? per_vertex_normals[c[2]] : no_normal,
+					default_color, ( c[1] >= 0 ) ? &texture_coords[c[1]] : &no_texture_coord );
 			}
+
+			surface->get_triangles()[t - groups[g].first_corner / 9] = Triangle( face_vertices[0], face_vertices[1], face_vertices[2], surface );
 		}
 	}
 
-	texture_coords.clear();
-	per_vertex_normals.clear();
-	vertices.clear();	
+	printf( "%I64u group(s)\n", groups.size() );
+
+	if ( indexed )
+	{
+		size_t no_welded = 0;
+		for ( size_t i = 0; i < groups.size(); ++i )
+		{
+			no_welded += surfaces[first_surface + i]->no_vertices();
+		}
+
+		printf( "%d triangle(s), %I64u welded vertices instead of %d\n", no_triangles, no_welded, no_triangles * 3 );
+	}
 
-	SAFE_DELETE_ARRAY( buffer_backup );
-	SAFE_DELETE_ARRAY( buffer );	
+	printf( "Parsed in %0.3f s with %d thread(s).\n", omp_get_wtime() - t0, omp_get_max_threads() );
 
 	printf( "\nDone.\n\n");
 
-	return no_surfaces;
+	if ( use_cache )
+	{
+		SceneCache::Save( cache_name.c_str(), file_name, material_libraries, default_color, flip_yz, indexed, surfaces, first_surface );
+	}
+
+	return static_cast<int>( groups.size() );
 }
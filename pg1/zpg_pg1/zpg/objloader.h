@@ -12,9 +12,11 @@ System Unit Setup -> 1 Unit = 1,0 m a za
 \param surfaces pole ploch, do kterho se budou ukldat naten plochy.
 \param materials pole materil, do kterho se budou ukldat naten materily.
 \param flip_yz rotace kolem osy x o + 90st.
+\param use_cache nacist plochy z binarni cache file_name + ".cache", je-li platna, a jinak ji po parsovani vytvorit.
+\param indexed vytvoit indexovan plochy se svaenmi vrcholy msto pol trojhelnk.
 */
 int LoadOBJ( const char * file_name, Vector3 & default_color,
 	std::vector<Surface *> & surfaces, std::vector<Material *> & materials,
-	const bool flip_yz = false );
+	const bool flip_yz = false, const bool use_cache = true, const bool indexed = false );
 
 #endif
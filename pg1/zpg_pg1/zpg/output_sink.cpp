@@ -0,0 +1,460 @@
+#include "stdafx.h"
+
+OutputSink::OutputSink()
+{
+	busy_ = false;
+	stop_ = false;
+
+	thread_ = std::thread( &OutputSink::Loop, this );
+}
+
+OutputSink::~OutputSink()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		stop_ = true;
+	}
+
+	changed_.notify_all();
+	thread_.join();
+}
+
+void OutputSink::Write( const std::string & file_name, const cv::Mat & image )
+{
+	Job job;
+	job.file_name = file_name;
+	job.multilayer = false;
+
+	OutputLayer layer;
+	layer.image = image;
+	job.layers.push_back( layer );
+
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		jobs_.push_back( job );
+	}
+
+	changed_.notify_all();
+}
+
+void OutputSink::WriteLayers( const std::string & file_name, const std::vector<OutputLayer> & layers )
+{
+	Job job;
+	job.file_name = file_name;
+	job.multilayer = true;
+	job.layers = layers;
+
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		jobs_.push_back( job );
+	}
+
+	changed_.notify_all();
+}
+
+void OutputSink::Flush()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+
+	changed_.wait( lock, [this] { return jobs_.empty() && !busy_; } );
+}
+
+void OutputSink::Loop()
+{
+	for ( ; ; )
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+
+			changed_.wait( lock, [this] { return !jobs_.empty() || stop_; } );
+
+			// pri ukonceni se fronta nejdriv doprazdni
+			if ( jobs_.empty() )
+			{
+				break;
+			}
+
+			job = jobs_.front();
+			jobs_.pop_front();
+			busy_ = true;
+		}
+
+		const int status = job.multilayer ? SaveEXR( job.file_name, job.layers ) : Save( job.file_name, job.layers[0].image );
+
+		// cesta se vypise az po zapisu, chyby uz ohlasilo Save/SaveEXR
+		if ( status == 0 )
+		{
+			printf( "%s\n", job.file_name.c_str() );
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			busy_ = false;
+		}
+
+		changed_.notify_all();
+	}
+}
+
+static bool HasExtension( const std::string & file_name, const char * extension )
+{
+	const size_t n = strlen( extension );
+
+	if ( file_name.size() < n )
+	{
+		return false;
+	}
+
+	for ( size_t i = 0; i < n; ++i )
+	{
+		if ( tolower( file_name[file_name.size() - n + i] ) != extension[i] )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int OutputSink::Save( const std::string & file_name, const cv::Mat & image )
+{
+	if ( HasExtension( file_name, ".pfm" ) )
+	{
+		return SavePFM( file_name, image );
+	}
+
+	if ( !cv::imwrite( file_name, image ) )
+	{
+		printf( "File %s cannot be written.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	return 0;
+}
+
+int OutputSink::SavePFM( const std::string & file_name, const cv::Mat & image )
+{
+	if ( image.type() != CV_32FC3 && image.type() != CV_32FC1 )
+	{
+		printf( "PFM %s needs a float image.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	FILE * file = fopen( file_name.c_str(), "wb" );
+
+	if ( file == NULL )
+	{
+		printf( "File %s cannot be written.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	const int channels = image.channels();
+
+	// zaporne meritko = little-endian, radky zdola nahoru
+	fprintf( file, "%s\n%d %d\n-1.0\n", ( channels == 3 ) ? "PF" : "Pf", image.cols, image.rows );
+
+	std::vector<float> row( image.cols * channels );
+	bool failed = false;
+
+	for ( int y = image.rows - 1; y >= 0 && !failed; --y )
+	{
+		const float * src = image.ptr<float>( y );
+
+		for ( int x = 0; x < image.cols; ++x )
+		{
+			for ( int c = 0; c < channels; ++c )
+			{
+				row[x * channels + c] = src[x * channels + channels - 1 - c]; // BGR -> RGB
+			}
+		}
+
+		failed = fwrite( &row[0], sizeof( float ), row.size(), file ) != row.size();
+	}
+
+	fclose( file );
+
+	if ( failed )
+	{
+		printf( "Writing %s failed.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	return 0;
+}
+
+int OutputSink::ParseFormats( const char * list )
+{
+	static const char * names[] = { "png", "pfm", "exr" };
+
+	int formats = 0;
+	std::string name;
+
+	for ( const char * c = list; ; ++c )
+	{
+		if ( *c != ',' && *c != 0 )
+		{
+			name += static_cast<char>( tolower( *c ) );
+			continue;
+		}
+
+		int format = -1;
+
+		for ( int i = 0; i < 3; ++i )
+		{
+			if ( name == names[i] )
+			{
+				format = 1 << i;
+			}
+		}
+
+		if ( format < 0 )
+		{
+			return -1;
+		}
+
+		formats |= format;
+		name.clear();
+
+		if ( *c == 0 )
+		{
+			break;
+		}
+	}
+
+	return formats;
+}
+
+std::string OutputSink::AsDirectory( const std::string & dir )
+{
+	if ( dir.empty() || dir[dir.size() - 1] == '\\' || dir[dir.size() - 1] == '/' )
+	{
+		return dir;
+	}
+
+	return dir + "\\";
+}
+
+static void PutInt( std::vector<char> & data, const int value )
+{
+	for ( int i = 0; i < 4; ++i )
+	{
+		data.push_back( static_cast<char>( ( value >> ( 8 * i ) ) & 0xff ) );
+	}
+}
+
+static void PutFloat( std::vector<char> & data, const float value )
+{
+	int bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	PutInt( data, bits );
+}
+
+static void PutString( std::vector<char> & data, const std::string & value )
+{
+	data.insert( data.end(), value.begin(), value.end() );
+	data.push_back( 0 );
+}
+
+// atribut hlavicky: nazev, typ, velikost a hodnota
+static void PutAttribute( std::vector<char> & data, const char * name, const char * type, const std::vector<char> & value )
+{
+	PutString( data, name );
+	PutString( data, type );
+	PutInt( data, static_cast<int>( value.size() ) );
+	data.insert( data.end(), value.begin(), value.end() );
+}
+
+/*! \struct ExrChannel
+\brief Kanal OpenEXR: nazev a slozka zdrojoveho obrazu.
+
+Kanaly obrazu CV_32F se zapisuji jako FLOAT, CV_32S jako UINT se stejnymi
+32 bity (presne i nad 2^24, -1 = 0xffffffff).
+*/
+struct ExrChannel
+{
+	std::string name;
+	const cv::Mat * image;
+	int component;
+
+	bool operator<( const ExrChannel & other ) const
+	{
+		return strcmp( name.c_str(), other.name.c_str() ) < 0;
+	}
+};
+
+int OutputSink::SaveEXR( const std::string & file_name, const std::vector<OutputLayer> & layers )
+{
+	// rozmery urcuje prvni neprazdna vrstva, prazdne vrstvy se preskakuji
+	size_t first = 0;
+
+	while ( first < layers.size() && layers[first].image.empty() )
+	{
+		++first;
+	}
+
+	if ( first == layers.size() )
+	{
+		printf( "No layers to write to %s.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	const int width = layers[first].image.cols;
+	const int height = layers[first].image.rows;
+
+	std::vector<ExrChannel> channels;
+
+	for ( size_t i = 0; i < layers.size(); ++i )
+	{
+		const OutputLayer & layer = layers[i];
+
+		if ( layer.image.empty() )
+		{
+			continue;
+		}
+
+		if ( layer.image.cols != width || layer.image.rows != height || layer.image.depth() != CV_32F && layer.image.depth() != CV_32S ||
+			static_cast<int>( layer.channels.size() ) != layer.image.channels() )
+		{
+			printf( "Layer %s does not match %s, skipped.\n", layer.name.c_str(), file_name.c_str() );
+			continue;
+		}
+
+		for ( int c = 0; c < layer.image.channels(); ++c )
+		{
+			ExrChannel channel;
+			channel.name = ( layer.name.empty() ? "" : layer.name + "." ) + layer.channels[c];
+			channel.image = &layer.image;
+			channel.component = c;
+
+			channels.push_back( channel );
+		}
+	}
+
+	// prazdny chlist neni platny EXR
+	if ( channels.empty() )
+	{
+		printf( "No layer matches %s, nothing written.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	// kanaly musi byt serazene podle nazvu, ve stejnem poradi jsou i v radcich
+	std::sort( channels.begin(), channels.end() );
+
+	std::vector<char> header;
+	PutInt( header, 20000630 ); // magicke cislo
+	PutInt( header, 2 ); // verze 2, jednoduchy scanline soubor
+
+	std::vector<char> value;
+
+	for ( size_t i = 0; i < channels.size(); ++i )
+	{
+		PutString( value, channels[i].name );
+		PutInt( value, ( channels[i].image->depth() == CV_32S ) ? 0 : 2 ); // UINT nebo FLOAT
+		PutInt( value, 0 ); // pLinear a rezervovane byty
+		PutInt( value, 1 ); // xSampling
+		PutInt( value, 1 ); // ySampling
+	}
+
+	value.push_back( 0 );
+	PutAttribute( header, "channels", "chlist", value );
+
+	value.assign( 1, 0 ); // NO_COMPRESSION
+	PutAttribute( header, "compression", "compression", value );
+
+	value.clear();
+	PutInt( value, 0 );
+	PutInt( value, 0 );
+	PutInt( value, width - 1 );
+	PutInt( value, height - 1 );
+	PutAttribute( header, "dataWindow", "box2i", value );
+	PutAttribute( header, "displayWindow", "box2i", value );
+
+	value.assign( 1, 0 ); // INCREASING_Y
+	PutAttribute( header, "lineOrder", "lineOrder", value );
+
+	value.clear();
+	PutFloat( value, 1.0f );
+	PutAttribute( header, "pixelAspectRatio", "float", value );
+
+	value.clear();
+	PutFloat( value, 0.0f );
+	PutFloat( value, 0.0f );
+	PutAttribute( header, "screenWindowCenter", "v2f", value );
+
+	value.clear();
+	PutFloat( value, 1.0f );
+	PutAttribute( header, "screenWindowWidth", "float", value );
+
+	header.push_back( 0 ); // konec hlavicky
+
+	FILE * file = fopen( file_name.c_str(), "wb" );
+
+	if ( file == NULL )
+	{
+		printf( "File %s cannot be written.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	fwrite( &header[0], 1, header.size(), file );
+
+	// tabulka pozic radku, kazdy radek ma stejnou velikost (UINT i FLOAT maji 4 byty)
+	const int line_size = static_cast<int>( channels.size() ) * width * 4;
+	const unsigned long long first_line = header.size() + 8ull * height;
+
+	for ( int y = 0; y < height; ++y )
+	{
+		const unsigned long long offset = first_line + static_cast<unsigned long long>( y ) * ( 8 + line_size );
+		fwrite( &offset, sizeof( offset ), 1, file ); // little-endian jako cely soubor
+	}
+
+	std::vector<char> line;
+	bool failed = false;
+
+	for ( int y = 0; y < height && !failed; ++y )
+	{
+		line.clear();
+		PutInt( line, y );
+		PutInt( line, line_size );
+
+		for ( size_t i = 0; i < channels.size(); ++i )
+		{
+			const cv::Mat & image = *channels[i].image;
+			const int n = image.channels();
+			const int c = channels[i].component;
+
+			for ( int x = 0; x < width; ++x )
+			{
+				if ( image.depth() == CV_32S )
+				{
+					PutInt( line, image.ptr<int>( y )[x * n + c] );
+				}
+				else
+				{
+					PutFloat( line, image.ptr<float>( y )[x * n + c] );
+				}
+			}
+		}
+
+		failed = fwrite( &line[0], 1, line.size(), file ) != line.size();
+	}
+
+	fclose( file );
+
+	if ( failed )
+	{
+		printf( "Writing %s failed.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	return 0;
+}
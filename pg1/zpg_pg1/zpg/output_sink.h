@@ -0,0 +1,99 @@
+#ifndef OUTPUT_SINK_H_
+#define OUTPUT_SINK_H_
+
+/*! \enum OutputFormat
+\brief Bitove priznaky vystupnich formatu snimku.
+*/
+enum OutputFormat
+{
+	OUTPUT_PNG = 1, /*!< 8-bitove PNG po resolve (expozice, tonemapovani). */
+	OUTPUT_PFM = 2, /*!< Float PFM bez ztraty HDR. */
+	OUTPUT_EXR = 4 /*!< Vicevrstvy OpenEXR (snimek, denoise a pomocne buffery), float kanaly a id jako UINT. */
+};
+
+/*! \struct OutputLayer
+\brief Jedna vrstva vicevrstveho obrazu.
+*/
+struct OutputLayer
+{
+	std::string name; /*!< Nazev vrstvy, prazdny pro hlavni obraz (kanaly R, G, B). */
+	cv::Mat image; /*!< Data CV_32FCn nebo CV_32SCn. */
+	std::string channels; /*!< Nazev kanalu pro kazdou slozku Mat, napr. "BGR" nebo "XYZ". */
+
+	OutputLayer() {}
+	OutputLayer( const std::string & name, const cv::Mat & image, const std::string & channels ) : name( name ), image( image ), channels( channels ) {}
+};
+
+/*! \class OutputSink
+\brief Zapis vystupnich obrazu ve vlastnim vlakne.
+
+Renderer preda hotovy obraz do fronty a pokracuje dalsim snimkem,
+kodovani a zapis na disk probiha na pozadi. Cesta souboru se vypise
+na stdout az po uspesnem zapisu. Predany cv::Mat se nekopiruje,
+fronta si drzi jen hlavicku se sdilenymi daty, a proto se obraz po predani
+uz nesmi menit.
+
+Podle pripony souboru se zapisuje PNG/JPG pres cv::imwrite, PFM a
+OpenEXR (bez komprese, kanaly FLOAT, celociselne vrstvy UINT) vlastnim kodem.
+*/
+class OutputSink
+{
+public:
+	//! Vychozi konstruktor, spusti vlakno zapisu.
+	OutputSink();
+
+	//! Destruktor, zapise vse, co je ve fronte, a ukonci vlakno.
+	~OutputSink();
+
+	//! Zaradi obraz \a image k zapisu do \a file_name, format podle pripony (.pfm nebo cokoliv pro cv::imwrite).
+	void Write( const std::string & file_name, const cv::Mat & image );
+
+	//! Zaradi vrstvy \a layers k zapisu do vicevrstveho OpenEXR \a file_name.
+	void WriteLayers( const std::string & file_name, const std::vector<OutputLayer> & layers );
+
+	//! Pocka, az bude fronta prazdna.
+	void Flush();
+
+	//! Synchronni zapis obrazu, format podle pripony.
+	/*!
+	\return 0 pri uspechu, -1 pri chybe.
+	*/
+	static int Save( const std::string & file_name, const cv::Mat & image );
+
+	//! Synchronni zapis obrazu CV_32FC3 (BGR) nebo CV_32FC1 do PFM.
+	static int SavePFM( const std::string & file_name, const cv::Mat & image );
+
+	//! Synchronni zapis vrstev do OpenEXR.
+	static int SaveEXR( const std::string & file_name, const std::vector<OutputLayer> & layers );
+
+	//! Seznam formatu oddeleny carkami (png,pfm,exr) na priznaky OutputFormat, -1 pro neznamy nazev.
+	static int ParseFormats( const char * list );
+
+	//! Adresar \a dir zakonceny oddelovacem, aby k nemu slo primo pripojit nazev souboru.
+	static std::string AsDirectory( const std::string & dir );
+
+private:
+	/*! \struct Job
+	\brief Polozka fronty, jeden vystupni soubor.
+	*/
+	struct Job
+	{
+		std::string file_name;
+		std::vector<OutputLayer> layers; /*!< Jedina vrstva bez nazvu = obycejny obraz. */
+		bool multilayer;
+	};
+
+	void Loop();
+
+	std::thread thread_; /*!< Vlakno zapisu. */
+	std::mutex mutex_; /*!< Chrani frontu a priznaky. */
+	std::condition_variable changed_; /*!< Signalizace nove prace, dokonceni nebo ukonceni. */
+
+	std::deque<Job> jobs_; /*!< Cekajici soubory. */
+	bool busy_; /*!< Vlakno prave zapisuje. */
+	bool stop_; /*!< Pozadavek na ukonceni vlakna. */
+
+	DISALLOW_COPY_AND_ASSIGN( OutputSink );
+};
+
+#endif
@@ -50,6 +50,27 @@ RTCError check_rtc_or_die(RTCDevice & device)
 	return error;
 }
 
+// vybere nejsirsi paket primarnich paprsku, ktery zvladne Embree i CPU
+int SelectPacketSize(RTCDevice & device)
+{
+	if (rtcDeviceGetParameter1i(device, RTC_CONFIG_INTERSECT16) && cv::checkHardwareSupport(CV_CPU_AVX_512F))
+	{
+		return 16;
+	}
+
+	if (rtcDeviceGetParameter1i(device, RTC_CONFIG_INTERSECT8) && cv::checkHardwareSupport(CV_CPU_AVX))
+	{
+		return 8;
+	}
+
+	if (rtcDeviceGetParameter1i(device, RTC_CONFIG_INTERSECT4))
+	{
+		return 4;
+	}
+
+	return 1;
+}
+
 // struktury pro ukládání dat pro Embree
 namespace embree_structs
 {
@@ -100,6 +121,8 @@ Camera camera = Camera(Camera(640, 480, Vector3(2.0f, 2.0f, 0.0f), Vector3(0.0f,
 Vector3 lightDirection = Vector3(0, -2, -2);
 
 ggx_distribution distr;/// = ggx_distribution();
+Preview * preview = NULL; // v bezobrazovkovem rezimu (--headless) zustava NULL
+std::string noiseDir = "E:\\NoiseTextures\\"; // --noise-output <adresar>: kam GenerateNoiseTexture uklada textury
 
 std::string strTest = "26";
 
@@ -107,11 +130,16 @@ void TestCountSamples()
 {
 	int countSamples = 50;
 
+	// jediny progresivni pruchod ulozi snimky pro vsechny pocty vzorku (--snapshots je prepise)
+	const std::vector<int> snapshots = distr.snapshots;
+	if (distr.snapshots.empty()) distr.snapshots = { 10, 40, 50, 100 };
+
 	std::string str = strTest;//"18";
 	float roughness = -1.0f;
 	distr.StartRender(camera, cubeMap, lightDirection, countSamples, GOLD, str, -1, roughness);
 	distr.StartRender(camera, cubeMap, lightDirection, countSamples, IRON, str, -1, roughness);
 
+	distr.snapshots = snapshots;
 }
 
 void TestRoughness(GGXColor col)
@@ -130,6 +158,25 @@ void TestMetallic(GGXColor col)
 	distr.StartRender(camera, cubeMap, lightDirection, 50, col, "METALLICTest", -1, -1, 1.0);
 }
 
+// GOLD, IRON, SILVER x roughness 0.1 0.5 1.0 v jednom pruchodu, kazda varianta zvlast a arch 3 x 3
+void TestMaterialMatrix(int countSamples)
+{
+	const GGXColor colors[3] = { GOLD, IRON, SILVER };
+	const float roughness[3] = { 0.1f, 0.5f, 1.0f };
+
+	MaterialMatrix matrix;
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			matrix.Add(distr.MakeVariant(colors[i], -1, roughness[j]));
+		}
+	}
+
+	distr.RenderMaterialMatrix(camera, cubeMap, lightDirection, countSamples, matrix, "MATRIXTest", 3);
+}
+
 void JustTest(GGXColor col, int countSamples)
 {
 	distr.StartRender(camera, cubeMap, lightDirection, countSamples, col, "ReferenceImg", 2, 0.5, 0.33);
@@ -137,24 +184,30 @@ void JustTest(GGXColor col, int countSamples)
 
 int GenerateNoiseTexture(int width, int height, float roughness, std::string nameResult)
 {
-	cv::Mat src_8uc3_img(width, width, CV_32FC3);
+	Framebuffer framebuffer;
+	framebuffer.Create(width, height);
 
-	
+	const ResolveSettings settings; // smery, ne radiance: bez expozice a tonemapovani
 
-	cv::namedWindow(nameResult, 1);
+	if (preview != NULL) preview->Show(nameResult, framebuffer, settings);
 
-	for (int x = 0; x < width; x++)
+	// po radcich, pixely radku lezi v dlazdicich framebufferu za sebou
+#pragma omp parallel for schedule(dynamic, 4)
+	for (int y = 0; y < height; y++)
 	{
-		for (int y = 0; y < height; y++)
+		Sampler sampler(distr.seed, distr.sampler_type);
+
+		for (int x = 0; x < width; x++)
 		{
+			sampler.StartPixel(x, y);
 
-			Vector3 sampleVec = distr.GenerateGGXsampleVector(roughness);
+			Vector3 sampleVec = distr.GenerateGGXsampleVector(roughness, sampler);
 
 			sampleVec.Normalize();
 
 
 			
-			src_8uc3_img.at<cv::Vec3f>(y, x) = cv::Vec3f(sampleVec.z, (sampleVec.y + 1.0f) / 2.0f, (sampleVec.x + 1.0f) / 2.0f);
+			framebuffer.Set(x, y, cv::Vec3f(sampleVec.z, (sampleVec.y + 1.0f) / 2.0f, (sampleVec.x + 1.0f) / 2.0f));
 
 
 
@@ -169,18 +222,13 @@ int GenerateNoiseTexture(int width, int height, float roughness, std::string nam
 		//cvWaitKey(1);
 	}
 
-	cv::imshow(nameResult, src_8uc3_img); // display image
-	cv::moveWindow(nameResult, 10, 50);
-	cvWaitKey(1);
+	if (preview != NULL) preview->Finish();
 
 	cv::Mat finalImage;
 
-	cv::convertScaleAbs(src_8uc3_img, finalImage, 255.0f);
+	framebuffer.Resolve(finalImage, settings);
 
-	std::string path = "E:\\NoiseTextures\\";
-	std::string resultPath = path + nameResult + ".png";
-	cv::imwrite(resultPath, finalImage);
-	std::cout << resultPath << std::endl;
+	distr.WriteImage(noiseDir + nameResult + ".png", finalImage);
 	//cvSaveImage("D:\\" + str + ".jpg", src_8uc3_img);
 	//cvWaitKey(0);
 	//std::string str = "GGX_Distribution metallic(" + std::to_string(metallic) + ")  roughness(" + std::to_string(roughness) + ")";
@@ -189,30 +237,283 @@ int GenerateNoiseTexture(int width, int height, float roughness, std::string nam
 	return 0;
 }
 
+// seznam poctu vzorku oddeleny carkami, vysledek vzestupne bez opakovani a nekladnych hodnot
+void ParseSampleCounts(const char * list, std::vector<int> & counts)
+{
+	counts.clear();
+
+	for (const char * p = list; *p != '\0';)
+	{
+		char * end = NULL;
+		const long count = strtol(p, &end, 10);
+
+		if (end == p) break;
+		if (count > 0) counts.push_back(static_cast<int>(count));
+
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	std::sort(counts.begin(), counts.end());
+	counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+}
+
 int main(int argc, char * argv[])
 {
 
 	printf("PG1, (c)2011-2016 Tomas Fabian\n\n");
 
+	// --headless: zadne okno ani HighGUI, --preview <ms>: perioda obnovy nahledu
+	bool headless = false;
+	int preview_interval = PREVIEW_INTERVAL;
+	int packet_size = -1; // --packet 1|4|8|16, -1 = automaticky
+	bool wavefront = false; // --wavefront: proudy paprsku a kompakce zasahu
+	unsigned int seed = 0; // --seed <n>: seed samplovani, obraz nezavisi na poctu vlaken
+	GGXSampling sampling = GGX_SAMPLING_REFLECTION; // --vndf: vzorkovani viditelnych mikronormal
+	SamplerType sampler_type = SAMPLER_RANDOM; // --sequence random|sobol|halton
+	bool use_prefiltered = false; // --prefiltered: split-sum odraz z predpocitaneho prostredi
+	int sh_bands = 0; // --sh 2|3: difuzni ozareni ze sferickych harmonik, 0 = vypnuto
+	bool use_environment_sampling = false; // --env-sampling: MIS GGX a vzorku prostredi podle jasu
+	bool filtered_sampling = false; // --filtered: mip pyramida cube mapy a cteni podle hustoty vzorku
+	bool use_gbuffer = true; // --no-gbuffer: kazdy render znovu trasuje primarni paprsky
+	bool use_scene_cache = true; // --no-scene-cache: vzdy parsovat OBJ a cache neukladat
+	bool indexed_mesh = false; // --indexed: svarene vrcholy a indexy misto pole trojuhelniku v kazde plose
+	bool quantized_mesh = false; // --quantized: indexovane plochy s osmistennymi normalami a half UV, zahrnuje --indexed
+	int denoise_iterations = 0; // --denoise <n>: a-trous filtr s n urovnemi, 0 = vypnuto
+	int width = 0, height = 0; // --resolution <sirka>x<vyska>: rozliseni kamery, 0 = podle sceny
+	bool stream_tiles = false; // --stream: hotove dlazdice rovnou do float TIFF, --stream-8bit do 8-bitoveho
+	TiledImageFormat stream_format = TILED_IMAGE_FLOAT32;
+	ResolveSettings resolve; // --exposure <x>, --tonemap clamp|reinhard|aces: prevod vysledku do 8 bitu
+	std::vector<int> snapshots; // --snapshots 10,40,50,100: progresivni render s ulozenim pri kazdem poctu vzorku
+	std::string output_dir; // --output <adresar>: kam se ukladaji vysledky, prazdne = vychozi ggx_distribution
+	int output_formats = OUTPUT_PNG; // --format png,pfm,exr: ukladane formaty
+	bool sync_output = false; // --sync-output: zapisovat obrazy primo v renderovacim vlakne
+	AdaptiveSampling adaptive; // --adaptive <prah> [--adaptive-round <n>] [--adaptive-cap <n>]: vzorky po kolech podle rozptylu
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+		else if (strcmp(argv[i], "--preview") == 0 && i + 1 < argc)
+		{
+			preview_interval = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--packet") == 0 && i + 1 < argc)
+		{
+			packet_size = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--wavefront") == 0)
+		{
+			wavefront = true;
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = static_cast<unsigned int>(strtoul(argv[++i], NULL, 10));
+		}
+		else if (strcmp(argv[i], "--vndf") == 0)
+		{
+			sampling = GGX_SAMPLING_VNDF;
+		}
+		else if (strcmp(argv[i], "--sh") == 0 && i + 1 < argc)
+		{
+			sh_bands = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--filtered") == 0)
+		{
+			filtered_sampling = true;
+		}
+		else if (strcmp(argv[i], "--no-gbuffer") == 0)
+		{
+			use_gbuffer = false;
+		}
+		else if (strcmp(argv[i], "--no-scene-cache") == 0)
+		{
+			use_scene_cache = false;
+		}
+		else if (strcmp(argv[i], "--indexed") == 0)
+		{
+			indexed_mesh = true;
+		}
+		else if (strcmp(argv[i], "--quantized") == 0)
+		{
+			indexed_mesh = true;
+			quantized_mesh = true;
+		}
+		else if (strcmp(argv[i], "--denoise") == 0 && i + 1 < argc)
+		{
+			denoise_iterations = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+			{
+				printf("Invalid resolution '%s', using the scene default.\n", argv[i]);
+				width = height = 0;
+			}
+		}
+		else if (strcmp(argv[i], "--exposure") == 0 && i + 1 < argc)
+		{
+			resolve.exposure = static_cast<float>(atof(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--tonemap") == 0 && i + 1 < argc)
+		{
+			const int tonemap = Framebuffer::ParseTonemap(argv[++i]);
+
+			if (tonemap < 0)
+			{
+				printf("Unknown tonemap '%s', using clamp.\n", argv[i]);
+			}
+			else
+			{
+				resolve.tonemap = static_cast<Tonemap>(tonemap);
+			}
+		}
+		else if (strcmp(argv[i], "--stream") == 0)
+		{
+			stream_tiles = true;
+			stream_format = TILED_IMAGE_FLOAT32;
+		}
+		else if (strcmp(argv[i], "--stream-8bit") == 0)
+		{
+			stream_tiles = true;
+			stream_format = TILED_IMAGE_UINT8;
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			output_dir = OutputSink::AsDirectory(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--noise-output") == 0 && i + 1 < argc)
+		{
+			noiseDir = OutputSink::AsDirectory(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			const int formats = OutputSink::ParseFormats(argv[++i]);
+
+			if (formats <= 0)
+			{
+				printf("Unknown output format list '%s', using png.\n", argv[i]);
+			}
+			else
+			{
+				output_formats = formats;
+			}
+		}
+		else if (strcmp(argv[i], "--sync-output") == 0)
+		{
+			sync_output = true;
+		}
+		else if (strcmp(argv[i], "--env-sampling") == 0)
+		{
+			use_environment_sampling = true;
+		}
+		else if (strcmp(argv[i], "--prefiltered") == 0)
+		{
+			use_prefiltered = true;
+		}
+		else if (strcmp(argv[i], "--snapshots") == 0 && i + 1 < argc)
+		{
+			ParseSampleCounts(argv[++i], snapshots);
+		}
+		else if (strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc)
+		{
+			adaptive.enabled = true;
+			adaptive.threshold = static_cast<float>(atof(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--adaptive-round") == 0 && i + 1 < argc)
+		{
+			adaptive.round_samples = MAX(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--adaptive-cap") == 0 && i + 1 < argc)
+		{
+			adaptive.max_samples = MAX(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--sequence") == 0 && i + 1 < argc)
+		{
+			const int type = Sampler::ParseType(argv[++i]);
+
+			if (type < 0)
+			{
+				printf("Unknown sample sequence '%s', using random.\n", argv[i]);
+			}
+			else
+			{
+				sampler_type = static_cast<SamplerType>(type);
+			}
+		}
+	}
+
 	_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON); // Flush to Zero, Denormals are Zero mode of the MXCSR
 	_MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
 	RTCDevice device = rtcNewDevice(NULL); // musíme vytvořit alespoň jedno Embree zařízení		
 	check_rtc_or_die(device); // ověření úspěšného vytvoření Embree zařízení
 	rtcDeviceSetErrorFunction(device, rtc_error_function); // registrace call-back funkce pro zachytávání chyb v Embree	
 
+	if (packet_size != 1 && packet_size != 4 && packet_size != 8 && packet_size != 16)
+	{
+		packet_size = SelectPacketSize(device);
+	}
+	printf("Primary ray packets: %d\n", packet_size);
+
+	if (wavefront && !rtcDeviceGetParameter1i(device, RTC_CONFIG_INTERSECT_STREAM))
+	{
+		printf("Ray streams are not supported, wavefront renderer disabled.\n");
+		wavefront = false;
+	}
+
 	std::vector<Surface *> surfaces;
 	std::vector<Material *> materials;
 
 	// načtení geometrie
-	//if (LoadOBJ("../../data/6887_allied_avenger.obj", Vector3(0.5f, 0.5f, 0.5f), surfaces, materials) < 0) { return -1; } camera = Camera(640, 480, Vector3(-200.0f, -200.0f, 100.0f), Vector3(40, -40, 5), DEG2RAD(42.185f));
-	if (LoadOBJ("../../data/geosphere.obj", Vector3(0.5f, 0.5f, 0.5f), surfaces, materials) < 0) { return -1; } camera = Camera(640, 480, Vector3(2.0f, 2.0f, 0.0f), Vector3(0.0f, 0.0f, 0.0f), DEG2RAD(42.185f));
+	//if (LoadOBJ("../../data/6887_allied_avenger.obj", Vector3(0.5f, 0.5f, 0.5f), surfaces, materials, false, use_scene_cache, indexed_mesh) < 0) { return -1; } camera = Camera(640, 480, Vector3(-200.0f, -200.0f, 100.0f), Vector3(40, -40, 5), DEG2RAD(42.185f));
+	if (LoadOBJ("../../data/geosphere.obj", Vector3(0.5f, 0.5f, 0.5f), surfaces, materials, false, use_scene_cache, indexed_mesh) < 0) { return -1; } camera = Camera(640, 480, Vector3(2.0f, 2.0f, 0.0f), Vector3(0.0f, 0.0f, 0.0f), DEG2RAD(42.185f));
 
+	if (quantized_mesh)
+	{
+		// cache zustava float, kvantuje se az po nacteni
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < static_cast<int>(surfaces.size()); ++i)
+		{
+			surfaces[i]->Quantize();
+		}
+	}
+
+	if (width > 0)
+	{
+		camera.set_width(width);
+		camera.set_height(height);
+		printf("Resolution: %d x %d\n", width, height);
+	}
 
 	// vytvoření scény v rámci Embree
-	RTCScene scene = rtcDeviceNewScene(device, RTC_SCENE_STATIC | RTC_SCENE_HIGH_QUALITY, RTC_INTERSECT1/* | RTC_INTERPOLATE*/);
+	int algorithm_flags = RTC_INTERSECT1/* | RTC_INTERPOLATE*/;
 	// RTC_INTERSECT1 = enables the rtcIntersect and rtcOccluded functions
+	// RTC_INTERSECT4/8/16 = enables the packet versions used for primary rays
+	switch (packet_size)
+	{
+	case 4: algorithm_flags |= RTC_INTERSECT4; break;
+	case 8: algorithm_flags |= RTC_INTERSECT8; break;
+	case 16: algorithm_flags |= RTC_INTERSECT16; break;
+	}
+	if (wavefront) algorithm_flags |= RTC_INTERSECT_STREAM; // rtcIntersectNM
+	RTCScene scene = rtcDeviceNewScene(device, RTC_SCENE_STATIC | RTC_SCENE_HIGH_QUALITY, static_cast<RTCAlgorithmFlags>(algorithm_flags));
+
+	// sdílení bufferů všech modelů s Embree
+	int max_triangles = 0; // indexy 0, 1, 2, ... jsou spolecne pro vsechny plochy s polem trojuhelniku
+	for (size_t i = 0; i < surfaces.size(); ++i)
+	{
+		if (!surfaces[i]->indexed()) max_triangles = MAX(max_triangles, surfaces[i]->no_triangles());
+	}
+
+	std::vector<embree_structs::Triangle> sequential_indices(max_triangles);
+	for (int t = 0; t < max_triangles; ++t)
+	{
+		sequential_indices[t].v0 = t * 3;
+		sequential_indices[t].v1 = t * 3 + 1;
+		sequential_indices[t].v2 = t * 3 + 2;
+	}
 
-	// nakopírování všech modelů do bufferů Embree
 	for (std::vector<Surface *>::const_iterator iter = surfaces.begin();
 	iter != surfaces.end(); ++iter)
 	{
@@ -226,39 +527,20 @@ int main(int argc, char * argv[])
 		//rtcSetOcclusionFilterFunction( scene, geom_id, reinterpret_cast< RTCFilterFunc >( &filter_occlusion ) );
 		//rtcSetIntersectionFilterFunction( scene, geom_id, reinterpret_cast< RTCFilterFunc >( &filter_intersection ) );
 
-		// kopírování samotných vertexů trojúhelníků
-		embree_structs::Vertex * vertices = static_cast< embree_structs::Vertex * >(
-			rtcMapBuffer(scene, geom_id, RTC_VERTEX_BUFFER));
+		// Embree cte pozice a indexy primo z pameti plochy, nic se nekopiruje;
+		// plochy musi zustat platne az do rtcDeleteScene
+		rtcSetBuffer(scene, geom_id, RTC_VERTEX_BUFFER, surface->vertex_buffer(), 0, surface->vertex_stride());
 
-		for (int t = 0; t < surface->no_triangles(); ++t)
+		if (surface->indexed())
 		{
-			for (int v = 0; v < 3; ++v)
-			{
-				embree_structs::Vertex & vertex = vertices[t * 3 + v];
-
-				vertex.x = surface->get_triangles()[t].vertex(v).position.x;
-				vertex.y = surface->get_triangles()[t].vertex(v).position.y;
-				vertex.z = surface->get_triangles()[t].vertex(v).position.z;
-			}
+			rtcSetBuffer(scene, geom_id, RTC_INDEX_BUFFER, surface->indices(), 0, sizeof(embree_structs::Triangle));
 		}
-
-		rtcUnmapBuffer(scene, geom_id, RTC_VERTEX_BUFFER);
-
-		// vytváření indexů vrcholů pro jednotlivé trojúhelníky
-		embree_structs::Triangle * triangles = static_cast< embree_structs::Triangle * >(
-			rtcMapBuffer(scene, geom_id, RTC_INDEX_BUFFER));
-
-		for (int t = 0, v = 0; t < surface->no_triangles(); ++t)
+		else
 		{
-			embree_structs::Triangle & triangle = triangles[t];
-
-			triangle.v0 = v++;
-			triangle.v1 = v++;
-			triangle.v2 = v++;
+			// vrcholy jdou v poli trojuhelniku za sebou
+			rtcSetBuffer(scene, geom_id, RTC_INDEX_BUFFER, sequential_indices.data(), 0, sizeof(embree_structs::Triangle));
 		}
 
-		rtcUnmapBuffer(scene, geom_id, RTC_INDEX_BUFFER);
-
 		/*embree_structs::Normal * normals = static_cast< embree_structs::Normal * >(
 		rtcMapBuffer( scene, geom_id, RTC_USER_VERTEX_BUFFER0 ) );
 		rtcUnmapBuffer( scene, geom_id, RTC_USER_VERTEX_BUFFER0 );*/
@@ -266,11 +548,87 @@ int main(int argc, char * argv[])
 
 	rtcCommit(scene);
 
+	size_t scene_memory = 0;
+	for (size_t i = 0; i < surfaces.size(); ++i)
+	{
+		scene_memory += surfaces[i]->memory_size();
+	}
+	printf("Scene geometry: %0.1f MB (%s)\n", scene_memory / SQR(1024.0f), quantized_mesh ? "quantized" : (indexed_mesh ? "indexed" : "triangles"));
+
 	cubeMap = CubeMap::CubeMap("../../data/yokohama");
 
+	if (filtered_sampling)
+	{
+		printf("Cube map mip pyramid: %d levels.\n", cubeMap.BuildMipmaps());
+	}
+
+	PrefilteredEnvironment * prefiltered = NULL;
+
+	if (use_prefiltered)
+	{
+		prefiltered = new PrefilteredEnvironment();
+
+		if (prefiltered->LoadOrBuild(cubeMap) != 0)
+		{
+			SAFE_DELETE(prefiltered);
+		}
+	}
+
+	SHIrradiance * sh_irradiance = NULL;
+
+	if (sh_bands > 0)
+	{
+		sh_irradiance = new SHIrradiance();
+
+		if (sh_irradiance->Project(cubeMap, sh_bands) != 0)
+		{
+			SAFE_DELETE(sh_irradiance);
+		}
+	}
+
+	EnvironmentSampler * environment_sampler = NULL;
+
+	if (use_environment_sampling)
+	{
+		environment_sampler = new EnvironmentSampler();
+
+		if (environment_sampler->Build(cubeMap) != 0)
+		{
+			SAFE_DELETE(environment_sampler);
+		}
+	}
 	
 
+	GBuffer gbuffer; // primarni zasahy se sdileji mezi rendery se stejnou kamerou
+	Denoiser * denoiser = (denoise_iterations > 0) ? new Denoiser(denoise_iterations) : NULL;
+	OutputSink * output = sync_output ? NULL : new OutputSink(); // kodovani a zapis obrazu na pozadi
+
 	distr = ggx_distribution(scene, surfaces);
+	distr.packet_size = packet_size;
+	distr.wavefront = wavefront;
+	distr.seed = seed;
+	distr.sampling = sampling;
+	distr.sampler_type = sampler_type;
+	distr.prefiltered = prefiltered;
+	distr.sh_irradiance = sh_irradiance;
+	distr.environment_sampler = environment_sampler;
+	distr.filtered_sampling = filtered_sampling;
+	distr.gbuffer = use_gbuffer ? &gbuffer : NULL;
+	distr.denoiser = denoiser;
+	distr.stream_tiles = stream_tiles;
+	distr.stream_format = stream_format;
+	distr.resolve = resolve;
+	distr.adaptive = adaptive;
+	distr.snapshots = snapshots;
+	distr.output_formats = output_formats;
+	distr.output = output;
+	if (!output_dir.empty()) distr.output_dir = output_dir;
+
+	if (!headless)
+	{
+		preview = new Preview(preview_interval);
+		distr.preview = preview;
+	}
 
 	/*TESTING BRDF********/
 
@@ -290,6 +648,7 @@ int main(int argc, char * argv[])
 
 	//TestRoughness(GOLD); //test na meneni roughness 0.1 0.5 1.0
 	//TestMetallic(GOLD); //test na meneni metallic 0.1 0.5 1.0
+	//TestMaterialMatrix(50); //barvy x roughness v jednom pruchodu
 
 
 	/*distr.GenerateTestingSamples(0.01, cv::Vec3b(0, 255, 0), "0.01");
@@ -298,7 +657,13 @@ int main(int argc, char * argv[])
 	distr.GenerateTestingSamples(0.75, cv::Vec3b(0, 255, 0), "0.75");
 	distr.GenerateTestingSamples(0.99, cv::Vec3b(0, 255, 0), "0.99");*/
 
-	cv::waitKey(0);
+	if (preview != NULL) preview->WaitKey();
+	SAFE_DELETE(preview);
+	SAFE_DELETE(prefiltered);
+	SAFE_DELETE(sh_irradiance);
+	SAFE_DELETE(environment_sampler);
+	SAFE_DELETE(denoiser);
+	SAFE_DELETE(output); // dopise obrazy, ktere jsou jeste ve fronte
 
 	rtcDeleteScene(scene); // zrušení Embree scény
 
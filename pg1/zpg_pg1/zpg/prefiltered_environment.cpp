@@ -0,0 +1,437 @@
+#include "stdafx.h"
+
+#define PREFILTERED_VERSION 2
+
+/*! \struct PrefilteredSource
+\brief Otisk souboru jedne steny cube mapy.
+*/
+struct PrefilteredSource
+{
+	unsigned long long size; /*!< Velikost souboru [B]. */
+	long long mtime; /*!< Cas posledni zmeny. */
+	unsigned long long hash; /*!< FNV-1a hash obsahu, porovnava se jen pri jinem case. */
+};
+
+/*! \struct PrefilteredHeader
+\brief Hlavicka souboru prefiltered.bin.
+*/
+struct PrefilteredHeader
+{
+	char magic[8]; /*!< "PFENV". */
+	int version; /*!< Verze formatu. */
+	int no_levels; /*!< PREFILTERED_LEVELS. */
+	int size; /*!< PREFILTERED_SIZE. */
+	int samples; /*!< PREFILTERED_SAMPLES. */
+	int lut_size; /*!< BRDF_LUT_SIZE. */
+	int lut_samples; /*!< BRDF_LUT_SAMPLES. */
+	PrefilteredSource sources[CUBEMAP_FACES]; /*!< Soubory sten v poradi posx, posy, posz, negx, negy, negz. */
+};
+
+// hlavicka s parametry prefiltrovani, otisky sten zustanou nulove
+static PrefilteredHeader MakeHeader()
+{
+	PrefilteredHeader header;
+	memset( &header, 0, sizeof( header ) );
+	strcpy( header.magic, "PFENV" );
+	header.version = PREFILTERED_VERSION;
+	header.no_levels = PREFILTERED_LEVELS;
+	header.size = PREFILTERED_SIZE;
+	header.samples = PREFILTERED_SAMPLES;
+	header.lut_size = BRDF_LUT_SIZE;
+	header.lut_samples = BRDF_LUT_SAMPLES;
+
+	return header;
+}
+
+// mikronormala GGX v lokalni bazi (z = normala) s hustotou D(h) cos(theta_h)
+static Vector3 SampleGGX( const float alpha, Sampler & sampler )
+{
+	const float epsilon = sampler.Next1D();
+	const float phi = sampler.Next1D( 0, static_cast<float>( M_PI * 2 ) );
+
+	const float cos2 = ( 1 - epsilon ) / ( epsilon * ( SQR( alpha ) - 1 ) + 1 );
+	const float sin_theta = sqrt( MAX( 0.0f, 1 - cos2 ) );
+
+	return Vector3( sin_theta * cos( phi ), sin_theta * sin( phi ), sqrt( cos2 ) );
+}
+
+static float SmithG1( const float NoX, const float alpha )
+{
+	const float cos2 = SQR( NoX );
+	const float tan2 = ( 1 - cos2 ) / MAX( cos2, 1e-6f );
+
+	return 2 / ( 1 + sqrt( 1 + SQR( alpha ) * tan2 ) );
+}
+
+PrefilteredEnvironment::PrefilteredEnvironment()
+{
+	source_ = NULL;
+	data_ = NULL;
+	data_size_ = 0;
+	brdf_lut_ = NULL;
+
+	for ( int level = 0; level < PREFILTERED_LEVELS; ++level )
+	{
+		offsets_[level] = data_size_;
+
+		if ( level > 0 )
+		{
+			data_size_ += CUBEMAP_FACES * SQR( LevelSize( level ) ) * 3;
+		}
+	}
+}
+
+PrefilteredEnvironment::~PrefilteredEnvironment()
+{
+	Release();
+}
+
+void PrefilteredEnvironment::Release()
+{
+	SAFE_DELETE_ARRAY( data_ );
+	SAFE_DELETE_ARRAY( brdf_lut_ );
+}
+
+float PrefilteredEnvironment::LevelRoughness( const int level )
+{
+	return level / static_cast<float>( PREFILTERED_LEVELS - 1 );
+}
+
+int PrefilteredEnvironment::LevelSize( const int level )
+{
+	return MAX( PREFILTERED_SIZE >> ( level - 1 ), 8 );
+}
+
+int PrefilteredEnvironment::LoadOrBuild( CubeMap & cube_map )
+{
+	const std::string file_name = cube_map.GetPath() + "/prefiltered.bin";
+
+	source_ = &cube_map;
+
+	if ( Load( file_name, cube_map ) == 0 )
+	{
+		printf( "Prefiltered environment loaded from %s.\n", file_name.c_str() );
+
+		return 0;
+	}
+
+	const double t0 = omp_get_wtime();
+
+	if ( Build( cube_map ) != 0 )
+	{
+		return -1;
+	}
+
+	printf( "Prefiltered environment built in %s.\n", TimeToString( omp_get_wtime() - t0 ).c_str() );
+
+	if ( Save( file_name, cube_map ) != 0 )
+	{
+		printf( "Unable to write %s, the environment will be prefiltered again next time.\n", file_name.c_str() );
+	}
+
+	return 0;
+}
+
+Vector3 PrefilteredEnvironment::PrefilterTexel( const Vector3 & n, const float alpha, Sampler & sampler ) const
+{
+	// baze kolem normaly
+	Vector3 t1 = ( abs( n.x ) > abs( n.z ) ) ? Vector3( -n.y, n.x, 0.0f ) : Vector3( 0.0f, -n.z, n.y );
+	t1.Normalize();
+	const Vector3 t2 = t1.CrossProduct( n );
+
+	Vector3 color = Vector3( 0, 0, 0 );
+	float weight = 0;
+
+	for ( int i = 0; i < PREFILTERED_SAMPLES; ++i )
+	{
+		sampler.StartSample( i );
+
+		const Vector3 h_local = SampleGGX( alpha, sampler );
+		const Vector3 h = t1 * h_local.x + t2 * h_local.y + n * h_local.z;
+
+		// N = V = R, smer dopadu je odraz normaly podle mikronormaly
+		Vector3 l = 2 * h_local.z * h - n;
+		const float NoL = n.DotProduct( l );
+
+		if ( NoL > 0 )
+		{
+			color += Vector3( source_->GetTexel( l ).data ) * NoL;
+			weight += NoL;
+		}
+	}
+
+	return ( weight > 0 ) ? color / weight : color;
+}
+
+int PrefilteredEnvironment::Build( CubeMap & cube_map )
+{
+	for ( int face = 0; face < CUBEMAP_FACES; ++face )
+	{
+		if ( cube_map.GetFace( face ) == NULL )
+		{
+			printf( "Cube map %s is incomplete, nothing to prefilter.\n", cube_map.GetPath().c_str() );
+
+			return -1;
+		}
+	}
+
+	Release();
+
+	source_ = &cube_map;
+	data_ = new float[data_size_];
+	brdf_lut_ = new float[SQR( BRDF_LUT_SIZE ) * 2];
+
+	// 1. retez prefiltrovanych cube map, paralelne pres vsechny texely vsech urovni
+	const int no_texels = data_size_ / 3;
+
+#pragma omp parallel for schedule( dynamic, 64 )
+	for ( int texel = 0; texel < no_texels; ++texel )
+	{
+		int level = PREFILTERED_LEVELS - 1;
+
+		while ( offsets_[level] > texel * 3 )
+		{
+			--level;
+		}
+
+		const int size = LevelSize( level );
+		const int index = texel - offsets_[level] / 3;
+		const int face = index / SQR( size );
+		const int x = index % size;
+		const int y = ( index / size ) % size;
+
+		Vector3 n = CubeMap::FaceToDirection( face, ( x + 0.5f ) / size, ( y + 0.5f ) / size );
+		n.Normalize();
+
+		Sampler sampler( 0, SAMPLER_SOBOL );
+		sampler.StartPixel( index, level );
+
+		const Vector3 color = PrefilterTexel( n, MAX( LevelRoughness( level ), 0.01f ), sampler );
+
+		data_[texel * 3 + 0] = color.x;
+		data_[texel * 3 + 1] = color.y;
+		data_[texel * 3 + 2] = color.z;
+	}
+
+	// 2. tabulka skaly a posunu F0, integral BRDF * cos pro F0 = 0 a F0 = 1
+#pragma omp parallel for schedule( dynamic )
+	for ( int cell = 0; cell < SQR( BRDF_LUT_SIZE ); ++cell )
+	{
+		const float NoV = ( cell % BRDF_LUT_SIZE + 0.5f ) / BRDF_LUT_SIZE;
+		const float alpha = MAX( ( cell / BRDF_LUT_SIZE + 0.5f ) / BRDF_LUT_SIZE, 0.01f );
+		const Vector3 v = Vector3( sqrt( 1 - SQR( NoV ) ), 0, NoV );
+
+		Sampler sampler( 0, SAMPLER_SOBOL );
+		sampler.StartPixel( cell, -1 );
+
+		float scale = 0;
+		float bias = 0;
+
+		for ( int i = 0; i < BRDF_LUT_SAMPLES; ++i )
+		{
+			sampler.StartSample( i );
+
+			const Vector3 h = SampleGGX( alpha, sampler );
+			const float VoH = v.DotProduct( h );
+			const Vector3 l = 2 * VoH * h - v;
+
+			if ( ( l.z > 0 ) && ( VoH > 0 ) )
+			{
+				// f * NoL / pdf, pdf = D NoH / (4 VoH)
+				const float g_vis = SmithG1( NoV, alpha ) * SmithG1( l.z, alpha ) * VoH / ( h.z * NoV );
+				const float fc = pow( 1 - VoH, 5 );
+
+				scale += ( 1 - fc ) * g_vis;
+				bias += fc * g_vis;
+			}
+		}
+
+		brdf_lut_[cell * 2 + 0] = scale / BRDF_LUT_SAMPLES;
+		brdf_lut_[cell * 2 + 1] = bias / BRDF_LUT_SAMPLES;
+	}
+
+	return 0;
+}
+
+int PrefilteredEnvironment::Load( const std::string & file_name, const CubeMap & cube_map )
+{
+	FILE * file = fopen( file_name.c_str(), "rb" );
+
+	if ( file == NULL )
+	{
+		return -1;
+	}
+
+	PrefilteredHeader expected = MakeHeader();
+	PrefilteredHeader header;
+
+	if ( fread( &header, sizeof( header ), 1, file ) != 1 )
+	{
+		fclose( file );
+
+		return -1;
+	}
+
+	// parametry se porovnaji cele, otisky sten zvlast
+	memcpy( expected.sources, header.sources, sizeof( header.sources ) );
+	bool stale = memcmp( &header, &expected, sizeof( header ) ) != 0;
+	bool touched = false;
+
+	for ( int face = 0; face < CUBEMAP_FACES && !stale; ++face )
+	{
+		const std::string source = cube_map.GetFaceFileName( face );
+		PrefilteredSource & stamp = header.sources[face];
+
+		unsigned long long size;
+		long long mtime;
+		GetFileStamp( source, size, mtime );
+
+		// stejne jako SceneCache, hash se pocita jen pri zmene casu
+		if ( size != stamp.size || ( mtime != stamp.mtime && HashFile( source ) != stamp.hash ) )
+		{
+			stale = true;
+		}
+		else if ( mtime != stamp.mtime )
+		{
+			stamp.mtime = mtime;
+			touched = true;
+		}
+	}
+
+	if ( stale )
+	{
+		fclose( file );
+
+		return -1;
+	}
+
+	Release();
+
+	data_ = new float[data_size_];
+	brdf_lut_ = new float[SQR( BRDF_LUT_SIZE ) * 2];
+
+	const bool ok = ( fread( data_, sizeof( float ), data_size_, file ) == static_cast<size_t>( data_size_ ) ) &&
+		( fread( brdf_lut_, sizeof( float ), SQR( BRDF_LUT_SIZE ) * 2, file ) == static_cast<size_t>( SQR( BRDF_LUT_SIZE ) * 2 ) );
+
+	fclose( file );
+	file = NULL;
+
+	if ( !ok )
+	{
+		Release();
+
+		return -1;
+	}
+
+	// obsah sten se nezmenil, jen cas - priste uz staci porovnat cas
+	if ( touched && ( file = fopen( file_name.c_str(), "r+b" ) ) != NULL )
+	{
+		fwrite( &header, sizeof( header ), 1, file );
+		fclose( file );
+	}
+
+	return 0;
+}
+
+int PrefilteredEnvironment::Save( const std::string & file_name, const CubeMap & cube_map ) const
+{
+	if ( ( data_ == NULL ) || ( brdf_lut_ == NULL ) )
+	{
+		return -1;
+	}
+
+	FILE * file = fopen( file_name.c_str(), "wb" );
+
+	if ( file == NULL )
+	{
+		return -1;
+	}
+
+	PrefilteredHeader header = MakeHeader();
+
+	for ( int face = 0; face < CUBEMAP_FACES; ++face )
+	{
+		const std::string source = cube_map.GetFaceFileName( face );
+		PrefilteredSource & stamp = header.sources[face];
+
+		GetFileStamp( source, stamp.size, stamp.mtime );
+		stamp.hash = HashFile( source );
+	}
+
+	const bool ok = ( fwrite( &header, sizeof( header ), 1, file ) == 1 ) &&
+		( fwrite( data_, sizeof( float ), data_size_, file ) == static_cast<size_t>( data_size_ ) ) &&
+		( fwrite( brdf_lut_, sizeof( float ), SQR( BRDF_LUT_SIZE ) * 2, file ) == static_cast<size_t>( SQR( BRDF_LUT_SIZE ) * 2 ) );
+
+	fclose( file );
+	file = NULL;
+
+	return ok ? 0 : -1;
+}
+
+Vector3 PrefilteredEnvironment::GetLevelTexel( const int level, const Vector3 & direction ) const
+{
+	float u = 0;
+	float v = 0;
+
+	const int face = CubeMap::DirectionToFace( direction, u, v );
+	const int size = LevelSize( level );
+	const float * texels = data_ + offsets_[level] + face * SQR( size ) * 3;
+
+	// texely lezi ve stredech bunek, na okraji steny se jen opakuje krajni texel
+	const float x = MAX( 0.0f, MIN( size - 1.0f, u * size - 0.5f ) );
+	const float y = MAX( 0.0f, MIN( size - 1.0f, v * size - 0.5f ) );
+
+	const int x0 = static_cast<int>( x );
+	const int y0 = static_cast<int>( y );
+	const int x1 = MIN( size - 1, x0 + 1 );
+	const int y1 = MIN( size - 1, y0 + 1 );
+
+	const float kx = x - x0;
+	const float ky = y - y0;
+
+	const float * p1 = texels + ( y0 * size + x0 ) * 3;
+	const float * p2 = texels + ( y0 * size + x1 ) * 3;
+	const float * p3 = texels + ( y1 * size + x1 ) * 3;
+	const float * p4 = texels + ( y1 * size + x0 ) * 3;
+
+	return Vector3( p1[0], p1[1], p1[2] ) * ( ( 1 - kx ) * ( 1 - ky ) ) +
+		Vector3( p2[0], p2[1], p2[2] ) * ( kx * ( 1 - ky ) ) +
+		Vector3( p3[0], p3[1], p3[2] ) * ( kx * ky ) +
+		Vector3( p4[0], p4[1], p4[2] ) * ( ( 1 - kx ) * ky );
+}
+
+Vector3 PrefilteredEnvironment::GetSpecular( const Vector3 & direction, const float roughness )
+{
+	const float level = MAX( 0.0f, MIN( 1.0f, roughness ) ) * ( PREFILTERED_LEVELS - 1 );
+	const int level0 = MIN( static_cast<int>( level ), PREFILTERED_LEVELS - 2 );
+	const float t = level - level0;
+
+	Vector3 d = direction;
+	const Vector3 c0 = ( level0 == 0 ) ? Vector3( source_->GetTexel( d ).data ) : GetLevelTexel( level0, direction );
+	const Vector3 c1 = GetLevelTexel( level0 + 1, direction );
+
+	return c0 * ( 1 - t ) + c1 * t;
+}
+
+Vector2 PrefilteredEnvironment::GetBRDF( const float NoV, const float roughness ) const
+{
+	const float x = MAX( 0.0f, MIN( BRDF_LUT_SIZE - 1.0f, NoV * BRDF_LUT_SIZE - 0.5f ) );
+	const float y = MAX( 0.0f, MIN( BRDF_LUT_SIZE - 1.0f, roughness * BRDF_LUT_SIZE - 0.5f ) );
+
+	const int x0 = static_cast<int>( x );
+	const int y0 = static_cast<int>( y );
+	const int x1 = MIN( BRDF_LUT_SIZE - 1, x0 + 1 );
+	const int y1 = MIN( BRDF_LUT_SIZE - 1, y0 + 1 );
+
+	const float kx = x - x0;
+	const float ky = y - y0;
+
+	const float * p1 = brdf_lut_ + ( y0 * BRDF_LUT_SIZE + x0 ) * 2;
+	const float * p2 = brdf_lut_ + ( y0 * BRDF_LUT_SIZE + x1 ) * 2;
+	const float * p3 = brdf_lut_ + ( y1 * BRDF_LUT_SIZE + x1 ) * 2;
+	const float * p4 = brdf_lut_ + ( y1 * BRDF_LUT_SIZE + x0 ) * 2;
+
+	return Vector2(
+		p1[0] * ( 1 - kx ) * ( 1 - ky ) + p2[0] * kx * ( 1 - ky ) + p3[0] * kx * ky + p4[0] * ( 1 - kx ) * ky,
+		p1[1] * ( 1 - kx ) * ( 1 - ky ) + p2[1] * kx * ( 1 - ky ) + p3[1] * kx * ky + p4[1] * ( 1 - kx ) * ky );
+}
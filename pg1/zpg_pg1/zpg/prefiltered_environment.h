@@ -0,0 +1,87 @@
+#ifndef PREFILTERED_ENVIRONMENT_H_
+#define PREFILTERED_ENVIRONMENT_H_
+
+#define PREFILTERED_LEVELS 6 // urovne drsnosti 0, 0.2, ..., 1, uroven 0 je primo zdrojova cube mapa
+#define PREFILTERED_SIZE 128 // velikost steny urovne 1, kazda dalsi uroven je polovicni
+#define PREFILTERED_SAMPLES 256 // pocet GGX vzorku na texel
+#define BRDF_LUT_SIZE 32 // rozliseni tabulky BRDF (NoV x drsnost)
+#define BRDF_LUT_SAMPLES 512 // pocet GGX vzorku na bunku tabulky
+
+/*! \class PrefilteredEnvironment
+\brief Predpocitane prostredi pro split-sum aproximaci GGX odrazu (Karis 2013).
+
+Integral odrazeneho prostredi se rozdeli na dve casti. Prvni je prostredi
+prefiltrovane GGX lalokem pro danou drsnost za predpokladu N = V = R,
+ulozene jako retez cube map indexovany drsnosti. Druhou je 2D tabulka
+(NoV, drsnost) se skalou a posunem Fresnelova clenu F0. Odraz pak stoji
+dve cteni misto SamplesCount vzorku prostredi.
+
+Obe casti se pocitaji paralelne a ukladaji do souboru prefiltered.bin
+v adresari cube mapy. Cache se pouzije, jen pokud souhlasi parametry
+a kazda stena zvlast: velikost a cas posledni zmeny souboru, pri jinem
+case pak hash obsahu (stejne jako SceneCache).
+
+Drsnost se pouziva primo jako alpha, stejne jako v ggx_distribution.
+*/
+class PrefilteredEnvironment
+{
+public:
+	//! Vychozi konstruktor.
+	PrefilteredEnvironment();
+
+	//! Destruktor.
+	~PrefilteredEnvironment();
+
+	//! Nacte data z cache v adresari cube mapy, pri neuspechu je spocita a cache ulozi.
+	/*!
+	\param cube_map zdrojova cube mapa, musi zit po celou dobu pouzivani teto tridy.
+	\return 0 pri uspechu, -1 pri chybe.
+	*/
+	int LoadOrBuild( CubeMap & cube_map );
+
+	//! Spocita prefiltrovane urovne a tabulku BRDF.
+	int Build( CubeMap & cube_map );
+
+	//! Nacte data ze souboru \a file_name.
+	/*!
+	\param file_name cesta k souboru cache.
+	\param cube_map zdrojova cube mapa, jeji steny musi souhlasit s otisky v cache.
+	\return 0 pri uspechu, -1 pokud soubor chybi nebo neodpovida.
+	*/
+	int Load( const std::string & file_name, const CubeMap & cube_map );
+
+	//! Ulozi data do souboru \a file_name spolu s otisky sten \a cube_map.
+	int Save( const std::string & file_name, const CubeMap & cube_map ) const;
+
+	//! Prefiltrovane prostredi ve smeru \a direction pro drsnost \a roughness.
+	Vector3 GetSpecular( const Vector3 & direction, const float roughness );
+
+	//! Skala (x) a posun (y) F0 z tabulky BRDF.
+	Vector2 GetBRDF( const float NoV, const float roughness ) const;
+
+	//! Drsnost prefiltrovane urovne \a level.
+	static float LevelRoughness( const int level );
+
+	//! Velikost steny prefiltrovane urovne \a level >= 1.
+	static int LevelSize( const int level );
+
+private:
+	//! Bilinearne interpolovany texel prefiltrovane urovne \a level >= 1.
+	Vector3 GetLevelTexel( const int level, const Vector3 & direction ) const;
+
+	//! Prefiltruje jeden texel, normala (= smer pohledu = smer odrazu) je \a n.
+	Vector3 PrefilterTexel( const Vector3 & n, const float alpha, Sampler & sampler ) const;
+
+	//! Uvolni data.
+	void Release();
+
+	CubeMap * source_; /*!< Zdrojova cube mapa, uroven 0. */
+	float * data_; /*!< RGB texely vsech prefiltrovanych urovni za sebou (uroven, stena, radek, sloupec). */
+	int offsets_[PREFILTERED_LEVELS]; /*!< Zacatek urovne v data_ [float]. */
+	int data_size_; /*!< Pocet floatu v data_. */
+	float * brdf_lut_; /*!< Tabulka BRDF_LUT_SIZE x BRDF_LUT_SIZE dvojic (skala, posun), radek = drsnost. */
+
+	DISALLOW_COPY_AND_ASSIGN( PrefilteredEnvironment );
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+
+Preview::Preview( const int interval )
+{
+	finish_ = false;
+	wait_key_ = false;
+	window_created_ = false;
+	stop_ = false;
+	interval_ = MAX( 1, interval );
+	framebuffer_ = NULL;
+
+	thread_ = std::thread( &Preview::Loop, this );
+}
+
+Preview::~Preview()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		stop_ = true;
+	}
+
+	thread_.join();
+}
+
+void Preview::Show( const std::string & name, const cv::Mat & image )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+
+	name_ = name;
+	source_ = image;
+	framebuffer_ = NULL;
+	finish_ = false;
+}
+
+void Preview::Show( const std::string & name, const Framebuffer & framebuffer, const ResolveSettings & settings )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+
+	name_ = name;
+	source_.release();
+	framebuffer_ = &framebuffer;
+	settings_ = settings;
+	finish_ = false;
+}
+
+void Preview::Finish()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+
+	if ( source_.empty() && framebuffer_ == NULL )
+	{
+		return;
+	}
+
+	// obraz muze byt lokalni promenna volajiciho, do jeho uvolneni se musi pockat
+	finish_ = true;
+	finished_.wait( lock, [this] { return !finish_ || stop_; } );
+}
+
+void Preview::WaitKey()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+
+	// bez okna neni kam klavesu stisknout
+	if ( !window_created_ )
+	{
+		return;
+	}
+
+	wait_key_ = true;
+	key_pressed_.wait( lock, [this] { return !wait_key_ || stop_; } );
+}
+
+void Preview::Loop()
+{
+	cv::Mat front; // vlastni kopie pro imshow
+	Framebuffer snapshot; // kopie akumulace, resolve probiha mimo zamek
+	std::string shown_name;
+
+	for ( ; ; )
+	{
+		bool update = false;
+		bool resolve = false;
+		ResolveSettings settings;
+
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+
+			if ( stop_ )
+			{
+				break;
+			}
+
+			if ( !source_.empty() || framebuffer_ != NULL )
+			{
+				// renderer do zdroje stale zapisuje, roztrzeny snimek nevadi, dalsi obnova ho opravi
+				if ( framebuffer_ != NULL )
+				{
+					snapshot = *framebuffer_;
+					settings = settings_;
+					resolve = true;
+				}
+				else
+				{
+					source_.copyTo( front );
+				}
+
+				update = true;
+
+				if ( name_ != shown_name )
+				{
+					shown_name = name_;
+					cv::namedWindow( shown_name, 1 );
+					cv::moveWindow( shown_name, 10, 50 );
+					window_created_ = true;
+				}
+
+				if ( finish_ )
+				{
+					source_.release();
+					framebuffer_ = NULL;
+					finish_ = false;
+					finished_.notify_all();
+				}
+			}
+		}
+
+		if ( resolve )
+		{
+			// seriove, druhy tym OpenMP by bral jadra rendereru
+			snapshot.Resolve( front, settings, false );
+		}
+
+		if ( update )
+		{
+			cv::imshow( shown_name, front );
+		}
+
+		const int key = cv::waitKey( interval_ ); // obsluha zprav oken
+
+		if ( key >= 0 )
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+
+			if ( wait_key_ )
+			{
+				wait_key_ = false;
+				key_pressed_.notify_all();
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock( mutex_ );
+	source_.release();
+	framebuffer_ = NULL;
+	finish_ = false;
+	wait_key_ = false;
+	key_pressed_.notify_all();
+	finished_.notify_all();
+}
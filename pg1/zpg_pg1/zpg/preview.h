@@ -0,0 +1,80 @@
+#ifndef PREVIEW_H_
+#define PREVIEW_H_
+
+/*! \def PREVIEW_INTERVAL
+\brief Vychozi perioda obnovy nahledu [ms].
+*/
+#define PREVIEW_INTERVAL 100
+
+/*! \class Preview
+\brief Nahled rozpracovaneho snimku ve vlastnim vlakne.
+
+Jako jedine vlakno v programu pracuje s HighGUI. S pevnou periodou si
+zkopiruje rozpracovany obraz (resp. akumulaci framebufferu) a teprve mimo
+zamek ho seriove prevede a zobrazi, renderovaci vlakna tak na okno nikdy
+necekaji. Kopie se dela bez
+synchronizace s rendererem, mezilehly snimek tedy muze byt roztrzeny,
+posledni prekresleni po Finish uz ale ukazuje hotovy obraz. V
+bezobrazovkovem rezimu se objekt vubec nevytvari.
+*/
+class Preview
+{
+public:
+	//! Obecny konstruktor, spusti vlakno nahledu.
+	/*!
+	\param interval perioda obnovy nahledu [ms].
+	*/
+	Preview( const int interval = PREVIEW_INTERVAL );
+
+	//! Destruktor, ukonci vlakno nahledu.
+	~Preview();
+
+	//! Zacne zobrazovat obraz \a image v okne \a name.
+	/*!
+	Obraz se nekopiruje, nahled si drzi jen hlavicku cv::Mat se sdilenymi daty.
+
+	\param name nazev okna.
+	\param image framebuffer typu CV_32FC3 nebo CV_8UC3, do ktereho se prave renderuje.
+	*/
+	void Show( const std::string & name, const cv::Mat & image );
+
+	//! Zacne zobrazovat framebuffer \a framebuffer v okne \a name, prevedeny podle \a settings.
+	/*!
+	Framebuffer musi existovat a nesmi se realokovat az do navratu z Finish.
+	*/
+	void Show( const std::string & name, const Framebuffer & framebuffer, const ResolveSettings & settings );
+
+	//! Obraz je hotovy, nahled jej naposledy prekresli a uvolni.
+	/*!
+	Vraci se az potom, co vlakno nahledu obraz uvolnilo, pak uz na nej nahled nesaha.
+	*/
+	void Finish();
+
+	//! Pocka, dokud uzivatel v nekterem okne nestiskne klavesu.
+	/*!
+	Pokud nahled zatim zadne okno neotevrel, vrati se hned, jinak by cekal navzdy.
+	*/
+	void WaitKey();
+
+private:
+	void Loop();
+
+	std::thread thread_; /*!< Vlakno nahledu. */
+	std::mutex mutex_; /*!< Chrani vsechny nasledujici polozky. */
+	std::condition_variable key_pressed_; /*!< Signalizace stisku klavesy. */
+	std::condition_variable finished_; /*!< Signalizace uvolneni obrazu po Finish. */
+
+	std::string name_; /*!< Nazev okna aktualniho obrazu. */
+	cv::Mat source_; /*!< Obraz, do ktereho se prave renderuje. */
+	const Framebuffer * framebuffer_; /*!< Akumulacni framebuffer misto \a source_, NULL = zadny. */
+	ResolveSettings settings_; /*!< Prevod \a framebuffer_ na zobrazitelny obraz. */
+	bool finish_; /*!< Pozadavek na posledni prekresleni a uvolneni \a source_. */
+	bool wait_key_; /*!< Nekdo ceka na stisk klavesy. */
+	bool window_created_; /*!< Nahled uz otevrel alespon jedno okno. */
+	bool stop_; /*!< Pozadavek na ukonceni vlakna. */
+	int interval_; /*!< Perioda obnovy [ms]. */
+
+	DISALLOW_COPY_AND_ASSIGN( Preview );
+};
+
+#endif
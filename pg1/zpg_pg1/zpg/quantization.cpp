@@ -0,0 +1,201 @@
+#include "stdafx.h"
+
+static float SignNotZero( const float value )
+{
+	return ( value >= 0.0f ) ? 1.0f : -1.0f;
+}
+
+static unsigned int PackSnorm16x2( const int x, const int y )
+{
+	return static_cast<unsigned short>( static_cast<short>( x ) ) |
+		( static_cast<unsigned int>( static_cast<unsigned short>( static_cast<short>( y ) ) ) << 16 );
+}
+
+static float UnpackSnorm16( const unsigned int value )
+{
+	return MAX( static_cast<short>( value & 0xffff ) / 32767.0f, -1.0f );
+}
+
+unsigned int EncodeOctahedral( const Vector3 & n )
+{
+	const float l1 = fabsf( n.x ) + fabsf( n.y ) + fabsf( n.z );
+
+	// nulova normala (chybejici vn) se nema jak zakodovat, bude z toho +z
+	if ( !( l1 > 0.0f ) )
+	{
+		return 0;
+	}
+
+	float x = n.x / l1;
+	float y = n.y / l1;
+
+	// dolni polokoule se preklopi do rohu ctverce
+	if ( n.z < 0.0f )
+	{
+		const float ox = x;
+		x = ( 1.0f - fabsf( y ) ) * SignNotZero( ox );
+		y = ( 1.0f - fabsf( ox ) ) * SignNotZero( y );
+	}
+
+	const int fx = static_cast<int>( floorf( x * 32767.0f ) );
+	const int fy = static_cast<int>( floorf( y * 32767.0f ) );
+
+	Vector3 direction = n;
+	direction.Normalize();
+
+	unsigned int best = 0;
+	float best_dot = -2.0f;
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		const unsigned int packed = PackSnorm16x2( MIN( MAX( fx + ( i & 1 ), -32767 ), 32767 ), MIN( MAX( fy + ( i >> 1 ), -32767 ), 32767 ) );
+		const float dot = DecodeOctahedral( packed ).DotProduct( direction );
+
+		if ( dot > best_dot )
+		{
+			best = packed;
+			best_dot = dot;
+		}
+	}
+
+	return best;
+}
+
+Vector3 DecodeOctahedral( const unsigned int packed )
+{
+	Vector3 n( UnpackSnorm16( packed ), UnpackSnorm16( packed >> 16 ), 0.0f );
+	n.z = 1.0f - fabsf( n.x ) - fabsf( n.y );
+
+	const float t = MAX( -n.z, 0.0f );
+	n.x += ( n.x >= 0.0f ) ? -t : t;
+	n.y += ( n.y >= 0.0f ) ? -t : t;
+	n.Normalize();
+
+	return n;
+}
+
+unsigned short FloatToHalf( const float value )
+{
+	unsigned int f;
+	memcpy( &f, &value, sizeof( f ) );
+
+	const unsigned int sign = f & 0x80000000u;
+	f ^= sign;
+
+	unsigned int h;
+
+	if ( f >= 0x47800000u ) // >= 65536, inf a NaN
+	{
+		h = ( f > 0x7f800000u ) ? 0x7e00 : 0x7c00;
+	}
+	else if ( f < 0x38800000u ) // < 2^-14, denormal nebo nula
+	{
+		// pricteni 0.5 posune mantisu tak, ze zaokrouhli hardware
+		float denormal;
+		memcpy( &denormal, &f, sizeof( f ) );
+		denormal += 0.5f;
+		memcpy( &h, &denormal, sizeof( h ) );
+		h -= 0x3f000000u;
+	}
+	else
+	{
+		// zmena biasu exponentu a zaokrouhleni k sudemu
+		const unsigned int odd = ( f >> 13 ) & 1;
+		f += ( static_cast<unsigned int>( 15 - 127 ) << 23 ) + 0xfff + odd;
+		h = f >> 13;
+	}
+
+	return static_cast<unsigned short>( h | ( sign >> 16 ) );
+}
+
+float HalfToFloat( const unsigned short value )
+{
+	// exponent a mantisa na sve misto, 2^112 opravi bias a pokryje i denormaly
+	const unsigned int bits = static_cast<unsigned int>( value & 0x7fff ) << 13;
+	const unsigned int sign = static_cast<unsigned int>( value & 0x8000 ) << 16;
+
+	float f;
+	memcpy( &f, &bits, sizeof( f ) );
+	f *= 5.192296858534828e+33f;
+
+	unsigned int result;
+	memcpy( &result, &f, sizeof( result ) );
+	result |= sign;
+	memcpy( &f, &result, sizeof( f ) );
+
+	return f;
+}
+
+unsigned int EncodeHalf2( const Vector2 & value )
+{
+	return FloatToHalf( value.x ) | ( static_cast<unsigned int>( FloatToHalf( value.y ) ) << 16 );
+}
+
+// soucet prvnich tri slozek x, y, z do jednoho vektoru
+static Vector3 SumLanes( __m128 x, __m128 y, __m128 z )
+{
+	__m128 w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+
+	RTCORE_ALIGN( 16 ) float sum[4];
+	_mm_store_ps( sum, _mm_add_ps( _mm_add_ps( x, y ), _mm_add_ps( z, w ) ) );
+
+	return Vector3( sum[0], sum[1], sum[2] );
+}
+
+Vector3 InterpolateOctahedral( const unsigned int p0, const unsigned int p1, const unsigned int p2, const float u, const float v )
+{
+	// slozka i = vrchol i, ctvrta slozka ma nulovou vahu
+	const __m128i packed = _mm_set_epi32( 0, static_cast<int>( p2 ), static_cast<int>( p1 ), static_cast<int>( p0 ) );
+
+	const __m128 scale = _mm_set1_ps( 1.0f / 32767.0f );
+	const __m128 minus_one = _mm_set1_ps( -1.0f );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 sign_mask = _mm_castsi128_ps( _mm_set1_epi32( 0x80000000 ) );
+
+	__m128 x = _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_slli_epi32( packed, 16 ), 16 ) ), scale ), minus_one );
+	__m128 y = _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( packed, 16 ) ), scale ), minus_one );
+
+	const __m128 abs_x = _mm_andnot_ps( sign_mask, x );
+	const __m128 abs_y = _mm_andnot_ps( sign_mask, y );
+	__m128 z = _mm_sub_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ), abs_x ), abs_y );
+
+	// x -= copysign( t, x ), stejne jako DecodeOctahedral
+	const __m128 t = _mm_max_ps( _mm_sub_ps( zero, z ), zero );
+	x = _mm_sub_ps( x, _mm_or_ps( t, _mm_and_ps( x, sign_mask ) ) );
+	y = _mm_sub_ps( y, _mm_or_ps( t, _mm_and_ps( y, sign_mask ) ) );
+
+	// normalizace vrcholovych normal a baricentricke vahy v jednom kroku
+	const __m128 weights = _mm_set_ps( 0.0f, v, u, 1.0f - u - v );
+	const __m128 length2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) );
+	const __m128 factor = _mm_div_ps( weights, _mm_sqrt_ps( length2 ) );
+
+	Vector3 normal = SumLanes( _mm_mul_ps( x, factor ), _mm_mul_ps( y, factor ), _mm_mul_ps( z, factor ) );
+	normal.Normalize();
+
+	return normal;
+}
+
+// half -> float ve vsech slozkach, bez inf a NaN
+static __m128 HalfToFloat4( const __m128i value )
+{
+	const __m128i bits = _mm_slli_epi32( _mm_and_si128( value, _mm_set1_epi32( 0x7fff ) ), 13 );
+	const __m128i sign = _mm_slli_epi32( _mm_and_si128( value, _mm_set1_epi32( 0x8000 ) ), 16 );
+
+	const __m128 f = _mm_mul_ps( _mm_castsi128_ps( bits ), _mm_castsi128_ps( _mm_set1_epi32( 0x77800000 ) ) ); // 2^112
+
+	return _mm_or_ps( f, _mm_castsi128_ps( sign ) );
+}
+
+Vector2 InterpolateHalf2( const unsigned int p0, const unsigned int p1, const unsigned int p2, const float u, const float v )
+{
+	const __m128i packed = _mm_set_epi32( 0, static_cast<int>( p2 ), static_cast<int>( p1 ), static_cast<int>( p0 ) );
+	const __m128 weights = _mm_set_ps( 0.0f, v, u, 1.0f - u - v );
+
+	const __m128 s = _mm_mul_ps( HalfToFloat4( packed ), weights );
+	const __m128 t = _mm_mul_ps( HalfToFloat4( _mm_srli_epi32( packed, 16 ) ), weights );
+
+	const Vector3 sum = SumLanes( s, t, _mm_setzero_ps() );
+
+	return Vector2( sum.x, sum.y );
+}
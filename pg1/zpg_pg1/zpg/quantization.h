@@ -0,0 +1,44 @@
+#ifndef QUANTIZATION_H_
+#define QUANTIZATION_H_
+
+/*
+Kompaktni kodovani atributu vrcholu.
+
+Jednotkovy vektor se promitne na osmistenne (octahedral) rozlozeni do
+ctverce [-1, 1]^2 a obe souradnice se ulozi jako 16-bitove snorm, tj. 32 bitu
+na normalu nebo tangentu misto 96 (chyba smeru pod 0.01 stupne). Texturovaci
+souradnice se ukladaji jako dvojice half float.
+
+Dekodovani tri vrcholu trojuhelniku probiha naraz v SSE2 registrech (vrchol
+na slozku), vcetne interpolace baricentrickymi souradnicemi.
+*/
+
+//! Zakoduje jednotkovy vektor \a n do 2x16 bitu (x v dolni, y v horni polovine).
+/*!
+Ze ctyr nejblizsich kvantovanych bodu se vybere ten, jehoz dekodovany smer
+je k \a n nejblize.
+*/
+unsigned int EncodeOctahedral( const Vector3 & n );
+
+//! Dekoduje jednotkovy vektor zakodovany EncodeOctahedral.
+Vector3 DecodeOctahedral( const unsigned int packed );
+
+//! Prevede float na half (IEEE 754 binary16) se zaokrouhlenim k nejblizsimu.
+unsigned short FloatToHalf( const float value );
+
+//! Prevede half na float.
+float HalfToFloat( const unsigned short value );
+
+//! Zakoduje texturovaci souradnici jako dvojici half (u v dolni, v v horni polovine).
+unsigned int EncodeHalf2( const Vector2 & value );
+
+//! Interpoluje normaly tri vrcholu zakodovane EncodeOctahedral a vysledek normalizuje.
+/*!
+Vahy odpovidaji Triangle::normal, tj. ( 1 - u - v ) pro \a p0, u pro \a p1 a v pro \a p2.
+*/
+Vector3 InterpolateOctahedral( const unsigned int p0, const unsigned int p1, const unsigned int p2, const float u, const float v );
+
+//! Interpoluje texturovaci souradnice tri vrcholu zakodovane EncodeHalf2.
+Vector2 InterpolateHalf2( const unsigned int p0, const unsigned int p1, const unsigned int p2, const float u, const float v );
+
+#endif
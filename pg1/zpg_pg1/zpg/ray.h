@@ -15,6 +15,17 @@ struct Ray : RTCRay
 	float transparency;
 	float ior;
 
+	//! Vychozi konstruktor, paprsek bez zasahu (napr. pro rozbaleni paketu).
+	Ray()
+	{
+		ior = 1.0f;
+		transparency = 3.14f;
+
+		geomID = RTC_INVALID_GEOMETRY_ID;
+		primID = RTC_INVALID_GEOMETRY_ID;
+		instID = RTC_INVALID_GEOMETRY_ID;
+	}
+
 	Ray( const Vector3 & origin, Vector3 direction, const float t_near = 0.0f, const float t_far = FLT_MAX )
 	{
 		ior = 1.0f;
@@ -46,6 +57,29 @@ struct Ray : RTCRay
 		ior = _ior;
 	}
 
+	//! Prevezme i-ty paprsek z paketu velikosti n vcetne informaci o zasahu.
+	void Unpack( RTCRayN * packet, const int n, const int i )
+	{
+		org[0] = RTCRayN_org_x( packet, n, i );
+		org[1] = RTCRayN_org_y( packet, n, i );
+		org[2] = RTCRayN_org_z( packet, n, i );
+		dir[0] = RTCRayN_dir_x( packet, n, i );
+		dir[1] = RTCRayN_dir_y( packet, n, i );
+		dir[2] = RTCRayN_dir_z( packet, n, i );
+		tnear = RTCRayN_tnear( packet, n, i );
+		tfar = RTCRayN_tfar( packet, n, i );
+		time = RTCRayN_time( packet, n, i );
+		mask = RTCRayN_mask( packet, n, i );
+		Ng[0] = RTCRayN_Ng_x( packet, n, i );
+		Ng[1] = RTCRayN_Ng_y( packet, n, i );
+		Ng[2] = RTCRayN_Ng_z( packet, n, i );
+		u = RTCRayN_u( packet, n, i );
+		v = RTCRayN_v( packet, n, i );
+		geomID = RTCRayN_geomID( packet, n, i );
+		primID = RTCRayN_primID( packet, n, i );
+		instID = RTCRayN_instID( packet, n, i );
+	}
+
 	Vector3 eval( const float t ) const
 	{
 		return Vector3(
@@ -0,0 +1,179 @@
+#include "stdafx.h"
+
+static const int halton_primes[HALTON_MAX_DIMENSION] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53 };
+
+static unsigned int ReverseBits( unsigned int x )
+{
+	x = ( ( x >> 1 ) & 0x55555555u ) | ( ( x & 0x55555555u ) << 1 );
+	x = ( ( x >> 2 ) & 0x33333333u ) | ( ( x & 0x33333333u ) << 2 );
+	x = ( ( x >> 4 ) & 0x0f0f0f0fu ) | ( ( x & 0x0f0f0f0fu ) << 4 );
+	x = ( ( x >> 8 ) & 0x00ff00ffu ) | ( ( x & 0x00ff00ffu ) << 8 );
+
+	return ( x >> 16 ) | ( x << 16 );
+}
+
+// Owenovo michani (Burley 2020, Practical Hash-based Owen Scrambling)
+static unsigned int NestedUniformScramble( unsigned int x, const unsigned int seed )
+{
+	x = ReverseBits( x );
+
+	// Laine-Karras permutace, kazdy bit zavisi jen na nizsich bitech
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+
+	return ReverseBits( x );
+}
+
+// druha dimenze Sobolovy posloupnosti, prvni je van der Corputova ReverseBits( i )
+static unsigned int Sobol2( unsigned int i )
+{
+	unsigned int r = 0;
+
+	for ( unsigned int v = 1u << 31; i != 0; i >>= 1, v ^= v >> 1 )
+	{
+		if ( i & 1 )
+		{
+			r ^= v;
+		}
+	}
+
+	return r;
+}
+
+unsigned int Sampler::Hash( unsigned int x )
+{
+	// https://nullprogram.com/blog/2018/07/31/
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+
+	return x;
+}
+
+float Sampler::ToFloat( const unsigned int bits )
+{
+	return ( bits >> 8 ) * ( 1.0f / 16777216.0f ); // 24 bitu mantisy, vysledek je vzdy < 1
+}
+
+int Sampler::ParseType( const char * name )
+{
+	if ( strcmp( name, "random" ) == 0 ) return SAMPLER_RANDOM;
+	if ( strcmp( name, "sobol" ) == 0 ) return SAMPLER_SOBOL;
+	if ( strcmp( name, "halton" ) == 0 ) return SAMPLER_HALTON;
+
+	return -1;
+}
+
+Sampler::Sampler( const unsigned int seed, const SamplerType type )
+{
+	seed_ = seed;
+	type_ = type;
+
+	StartPixel( 0, 0 );
+}
+
+void Sampler::StartPixel( const int x, const int y )
+{
+	x_ = x;
+	y_ = y;
+	pixel_key_ = Hash( static_cast<unsigned int>( x ) + Hash( static_cast<unsigned int>( y ) + Hash( seed_ ) ) );
+	first_sample_ = 0;
+
+	StartSample( 0 );
+}
+
+void Sampler::SetFirstSample( const int first_sample )
+{
+	first_sample_ = first_sample;
+}
+
+void Sampler::StartSample( const int sample )
+{
+	sample_ = first_sample_ + sample;
+	sample_key_ = Hash( static_cast<unsigned int>( sample_ ) + pixel_key_ );
+	dimension_ = 0;
+}
+
+unsigned int Sampler::Sobol( const int dimension ) const
+{
+	// kazda dvojice dimenzi je samostatna 2D posloupnost s vlastnim zamichanim poradi bodu (padding)
+	const unsigned int pair = static_cast<unsigned int>( dimension >> 1 );
+	const unsigned int index = NestedUniformScramble( static_cast<unsigned int>( sample_ ), Hash( pixel_key_ ^ Hash( pair ) ) );
+	const unsigned int bits = ( dimension & 1 ) ? Sobol2( index ) : ReverseBits( index );
+
+	return NestedUniformScramble( bits, Hash( pixel_key_ + Hash( static_cast<unsigned int>( dimension ) + 0x68e31da4u ) ) );
+}
+
+float Sampler::Halton( const int dimension ) const
+{
+	const int base = halton_primes[dimension];
+	const double inv_base = 1.0 / base;
+	double inv = inv_base;
+	double value = 0;
+
+	for ( unsigned int i = static_cast<unsigned int>( sample_ ); i > 0; i /= base, inv *= inv_base )
+	{
+		value += ( i % base ) * inv;
+	}
+
+	// posun na toru o hodnotu zavislou na pixelu a dimenzi
+	value += ToFloat( Hash( pixel_key_ + Hash( static_cast<unsigned int>( dimension ) + 0x68e31da4u ) ) );
+	value -= floor( value );
+
+	return MIN( static_cast<float>( value ), 0.99999994f );
+}
+
+float Sampler::Next1D()
+{
+	const int dimension = dimension_++;
+
+	if ( type_ == SAMPLER_SOBOL )
+	{
+		return ToFloat( Sobol( dimension ) );
+	}
+
+	if ( ( type_ == SAMPLER_HALTON ) && ( dimension < HALTON_MAX_DIMENSION ) )
+	{
+		return Halton( dimension );
+	}
+
+	return ToFloat( Hash( sample_key_ ^ Hash( static_cast<unsigned int>( dimension ) * 0x9e3779b9u ) ) );
+}
+
+float Sampler::Next1D( const float range_min, const float range_max )
+{
+	return Next1D() * ( range_max - range_min ) + range_min;
+}
+
+Vector2 Sampler::Next2D()
+{
+	const float u = Next1D();
+	const float v = Next1D();
+
+	return Vector2( u, v );
+}
+
+int Sampler::x() const
+{
+	return x_;
+}
+
+int Sampler::y() const
+{
+	return y_;
+}
+
+int Sampler::sample() const
+{
+	return sample_;
+}
+
+int Sampler::dimension() const
+{
+	return dimension_;
+}
@@ -0,0 +1,109 @@
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#define HALTON_MAX_DIMENSION 16 // vyssi dimenze Haltonovy posloupnosti nahradi nahodna cisla
+
+/*! \enum SamplerType
+\brief Posloupnost, ze ktere Sampler bere vzorky.
+*/
+enum SamplerType
+{
+	SAMPLER_RANDOM, /*!< Nezavisla nahodna cisla. */
+	SAMPLER_SOBOL, /*!< Sobolova (0,2)-posloupnost po dvojicich dimenzi, Owenovo michani per pixel. */
+	SAMPLER_HALTON /*!< Haltonova posloupnost, Cranleyho-Pattersonova rotace per pixel. */
+};
+
+/*! \class Sampler
+\brief Bezstavovy (counter-based) generator nahodnych cisel pro Monte Carlo.
+
+Kazde cislo je hash trojice (pixel, index vzorku, dimenze) a globalniho
+seedu, takze nezavisi na tom, ktere vlakno a v jakem poradi pixel pocita.
+Obraz je bitove stejny pro libovolny pocet vlaken a generator nepotrebuje
+zadny zamek ani sdileny stav.
+
+Misto nezavislych nahodnych cisel lze brat vzorky z nizkodiskrepancnich
+posloupnosti (SamplerType). Index vzorku je pak index bodu posloupnosti,
+takze vzorky jednoho pixelu maji byt cislovany souvisle od nuly. Kazdy
+pixel ma vlastni michani, aby se struktura posloupnosti neprojevila v obraze.
+
+\code{.cpp}
+Sampler sampler;
+sampler.StartPixel( x, y );
+for ( int i = 0; i < SamplesCount; ++i )
+{
+	sampler.StartSample( i );
+	float u = sampler.Next1D(); // dimenze 0, 1, 2...
+}
+\endcode
+*/
+class Sampler
+{
+public:
+	//! Obecny konstruktor.
+	/*!
+	\param seed globalni seed, ruzne seedy daji nezavisle obrazy.
+	\param type posloupnost vzorku.
+	*/
+	Sampler( const unsigned int seed = 0, const SamplerType type = SAMPLER_RANDOM );
+
+	//! Zacne pocitat pixel (x, y), nastavi vzorek 0 a prvni vzorek kola 0.
+	void StartPixel( const int x, const int y );
+
+	//! Zacne i-ty vzorek aktualniho kola, tj. vzorek first_sample + i, dimenze zacnou znovu od nuly.
+	void StartSample( const int sample );
+
+	//! Posune cislovani vzorku, dalsi kolo vzorku pixelu navazuje na predchozi.
+	/*!
+	Kod, ktery cisluje vzorky od nuly (GGX_Specular), tak muze bezet opakovane
+	pro tentyz pixel a pokracovat v posloupnosti misto opakovani stejnych vzorku.
+	*/
+	void SetFirstSample( const int first_sample );
+
+	//! Dalsi cislo z intervalu <0, 1), posune dimenzi o jednu.
+	float Next1D();
+
+	//! Dalsi cislo z intervalu <range_min, range_max).
+	float Next1D( const float range_min, const float range_max );
+
+	//! Dalsi dvojice cisel z <0, 1)^2, posune dimenzi o dve.
+	Vector2 Next2D();
+
+	//! Aktualni pixel.
+	int x() const;
+	int y() const;
+
+	//! Index aktualniho vzorku.
+	int sample() const;
+
+	//! Aktualni dimenze.
+	int dimension() const;
+
+	//! Celociselny hash s dobrou lavinovitosti (lowbias32).
+	static unsigned int Hash( unsigned int x );
+
+	//! Prevod 32 bitu na float z <0, 1).
+	static float ToFloat( const unsigned int bits );
+
+	//! Prevod nazvu ("random", "sobol", "halton") na typ, -1 pro neznamy nazev.
+	static int ParseType( const char * name );
+
+private:
+	//! Bity Owenovsky michane Sobolovy posloupnosti v dane dimenzi.
+	unsigned int Sobol( const int dimension ) const;
+
+	//! Rotovana Haltonova posloupnost v dane dimenzi.
+	float Halton( const int dimension ) const;
+
+	SamplerType type_; /*!< Posloupnost vzorku. */
+	unsigned int seed_; /*!< Globalni seed. */
+	unsigned int pixel_key_; /*!< Hash seedu a pixelu. */
+	unsigned int sample_key_; /*!< Hash seedu, pixelu a vzorku. */
+
+	int x_; /*!< Sloupec pixelu. */
+	int y_; /*!< Radek pixelu. */
+	int first_sample_; /*!< Index prvniho vzorku aktualniho kola. */
+	int sample_; /*!< Index vzorku. */
+	int dimension_; /*!< Index dalsi dimenze. */
+};
+
+#endif
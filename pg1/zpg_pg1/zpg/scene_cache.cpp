@@ -0,0 +1,608 @@
+#include "stdafx.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define SCENE_CACHE_VERSION 2
+
+static const char scene_cache_magic[8] = { 'Z', 'P', 'G', 'S', 'C', 'E', 'N', 'E' };
+
+MappedFile::MappedFile()
+{
+#ifdef _WIN32
+	file_ = NULL;
+	mapping_ = NULL;
+#else
+	file_ = -1;
+#endif
+
+	data_ = NULL;
+	size_ = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+int MappedFile::Open( const char * file_name )
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA( file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+
+	if ( file == INVALID_HANDLE_VALUE )
+	{
+		return -1;
+	}
+
+	LARGE_INTEGER size;
+
+	if ( !GetFileSizeEx( file, &size ) || size.QuadPart == 0 )
+	{
+		CloseHandle( file );
+
+		return -1;
+	}
+
+	HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	void * data = ( mapping != NULL ) ? MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+
+	if ( data == NULL )
+	{
+		if ( mapping != NULL )
+		{
+			CloseHandle( mapping );
+		}
+
+		CloseHandle( file );
+
+		return -1;
+	}
+
+	file_ = file;
+	mapping_ = mapping;
+	size_ = static_cast<size_t>( size.QuadPart );
+#else
+	const int file = open( file_name, O_RDONLY );
+
+	if ( file < 0 )
+	{
+		return -1;
+	}
+
+	struct stat status;
+	void * data = MAP_FAILED;
+
+	if ( fstat( file, &status ) == 0 && status.st_size > 0 )
+	{
+		data = mmap( NULL, static_cast<size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+	}
+
+	if ( data == MAP_FAILED )
+	{
+		close( file );
+
+		return -1;
+	}
+
+	file_ = file;
+	size_ = static_cast<size_t>( status.st_size );
+#endif
+
+	data_ = static_cast<const char *>( data );
+
+	return 0;
+}
+
+void MappedFile::Close()
+{
+	if ( data_ == NULL )
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile( data_ );
+	CloseHandle( mapping_ );
+	CloseHandle( file_ );
+
+	file_ = NULL;
+	mapping_ = NULL;
+#else
+	munmap( const_cast<char *>( data_ ), size_ );
+	close( file_ );
+
+	file_ = -1;
+#endif
+
+	data_ = NULL;
+	size_ = 0;
+}
+
+const char * MappedFile::data() const
+{
+	return data_;
+}
+
+size_t MappedFile::size() const
+{
+	return size_;
+}
+
+void GetFileStamp( const std::string & file_name, unsigned long long & size, long long & mtime )
+{
+#ifdef _WIN32
+	struct _stat64 status;
+	const int result = _stat64( file_name.c_str(), &status );
+#else
+	struct stat status;
+	const int result = stat( file_name.c_str(), &status );
+#endif
+
+	size = ( result == 0 ) ? static_cast<unsigned long long>( status.st_size ) : 0;
+	mtime = ( result == 0 ) ? static_cast<long long>( status.st_mtime ) : 0;
+}
+
+unsigned long long HashFile( const std::string & file_name )
+{
+	unsigned long long hash = 14695981039346656037ull;
+
+	MappedFile file;
+
+	if ( file.Open( file_name.c_str() ) == 0 )
+	{
+		const unsigned char * data = reinterpret_cast<const unsigned char *>( file.data() );
+
+		for ( size_t i = 0; i < file.size(); ++i )
+		{
+			hash = ( hash ^ data[i] ) * 1099511628211ull;
+		}
+	}
+
+	return hash;
+}
+
+// prepise casy zdroju v hlavicce cache, \a stamps jsou dvojice ( pozice v souboru, novy cas )
+static void UpdateSourceStamps( const char * cache_name, const std::vector< std::pair<size_t, long long> > & stamps )
+{
+	if ( stamps.empty() )
+	{
+		return;
+	}
+
+	FILE * file = fopen( cache_name, "r+b" );
+
+	if ( file == NULL )
+	{
+		return; // cache jen pro cteni, hash se bude pocitat i priste
+	}
+
+	for ( size_t i = 0; i < stamps.size(); ++i )
+	{
+		if ( _fseeki64( file, static_cast<long long>( stamps[i].first ), SEEK_SET ) != 0 ||
+			fwrite( &stamps[i].second, sizeof( stamps[i].second ), 1, file ) != 1 )
+		{
+			break;
+		}
+	}
+
+	fclose( file );
+}
+
+/*! \struct CacheReader
+\brief Cteni z namapovane cache s kontrolou mezi.
+*/
+struct CacheReader
+{
+	const char * data;
+	size_t size;
+	size_t offset;
+	bool failed; /*!< Cteni za koncem souboru. */
+
+	const char * Read( const size_t n )
+	{
+		if ( failed || n > size - offset )
+		{
+			failed = true;
+
+			return NULL;
+		}
+
+		const char * p = data + offset;
+		offset += n;
+
+		return p;
+	}
+
+	template <class T> T Get()
+	{
+		T value = T();
+		const char * p = Read( sizeof( T ) );
+
+		if ( p != NULL )
+		{
+			memcpy( &value, p, sizeof( T ) );
+		}
+
+		return value;
+	}
+
+	std::string GetString()
+	{
+		const unsigned int length = Get<unsigned int>();
+		const char * p = Read( length );
+		Align( 4 );
+
+		return ( p != NULL ) ? std::string( p, length ) : std::string();
+	}
+
+	void Align( const size_t alignment )
+	{
+		Read( ( alignment - offset % alignment ) % alignment );
+	}
+};
+
+/*! \struct CacheWriter
+\brief Sekvencni zapis cache se sledovanim pozice kvuli zarovnani.
+*/
+struct CacheWriter
+{
+	FILE * file;
+	unsigned long long offset;
+	bool failed;
+
+	void Write( const void * data, const size_t n )
+	{
+		if ( n > 0 && fwrite( data, 1, n, file ) != n )
+		{
+			failed = true;
+		}
+
+		offset += n;
+	}
+
+	template <class T> void Put( const T & value )
+	{
+		Write( &value, sizeof( T ) );
+	}
+
+	void PutString( const std::string & value )
+	{
+		Put( static_cast<unsigned int>( value.size() ) );
+		Write( value.data(), value.size() );
+		Align( 4 );
+	}
+
+	void Align( const size_t alignment )
+	{
+		static const char zeros[16] = { 0 };
+
+		Write( zeros, static_cast<size_t>( ( alignment - offset % alignment ) % alignment ) );
+	}
+};
+
+SceneCache::SceneCache()
+{
+	surfaces_offset_ = 0;
+	no_surfaces_ = 0;
+	indexed_ = false;
+}
+
+int SceneCache::Open( const char * cache_name, const Vector3 & default_color, const bool flip_yz, const bool indexed )
+{
+	Close();
+
+	if ( file_.Open( cache_name ) != 0 )
+	{
+		return -1;
+	}
+
+	CacheReader reader = { file_.data(), file_.size(), 0, false };
+
+	const char * magic = reader.Read( sizeof( scene_cache_magic ) );
+	const unsigned int version = reader.Get<unsigned int>();
+	const unsigned int triangle_size = reader.Get<unsigned int>();
+	const unsigned int vector_size = reader.Get<unsigned int>();
+	const unsigned int cached_flip_yz = reader.Get<unsigned int>();
+	const unsigned int cached_indexed = reader.Get<unsigned int>();
+	float color[3];
+	color[0] = reader.Get<float>();
+	color[1] = reader.Get<float>();
+	color[2] = reader.Get<float>();
+	const unsigned int no_sources = reader.Get<unsigned int>();
+	const unsigned int no_libraries = reader.Get<unsigned int>();
+	const unsigned int no_surfaces = reader.Get<unsigned int>();
+
+	if ( reader.failed || memcmp( magic, scene_cache_magic, sizeof( scene_cache_magic ) ) != 0 ||
+		version != SCENE_CACHE_VERSION || triangle_size != sizeof( Triangle ) || vector_size != sizeof( Vector3 ) ||
+		cached_flip_yz != ( flip_yz ? 1u : 0u ) || cached_indexed != ( indexed ? 1u : 0u ) ||
+		color[0] != default_color.x || color[1] != default_color.y || color[2] != default_color.z )
+	{
+		printf( "Scene cache %s does not match, rebuilding.\n", cache_name );
+		Close();
+
+		return -1;
+	}
+
+	std::vector< std::pair<size_t, long long> > stamps; // zdroje se starym casem a stejnym obsahem
+
+	for ( unsigned int i = 0; i < no_sources && !reader.failed; ++i )
+	{
+		const std::string source = reader.GetString();
+		const unsigned long long size = reader.Get<unsigned long long>();
+		const size_t mtime_offset = reader.offset;
+		const long long mtime = reader.Get<long long>();
+		const unsigned long long hash = reader.Get<unsigned long long>();
+
+		unsigned long long current_size;
+		long long current_mtime;
+		GetFileStamp( source, current_size, current_mtime );
+
+		// hash se pocita jen pri zmene casu, jinak staci velikost
+		if ( reader.failed || ( current_size == size && current_mtime == mtime ) )
+		{
+			continue;
+		}
+
+		if ( current_size != size || HashFile( source ) != hash )
+		{
+			printf( "Scene cache %s is outdated, %s has changed.\n", cache_name, source.c_str() );
+			Close();
+
+			return -1;
+		}
+
+		stamps.push_back( std::make_pair( mtime_offset, current_mtime ) );
+	}
+
+	for ( unsigned int i = 0; i < no_libraries; ++i )
+	{
+		material_libraries_.push_back( reader.GetString() );
+	}
+
+	reader.Align( 16 );
+	surfaces_offset_ = reader.offset;
+
+	// kontrola struktury celeho souboru, BuildSurfaces uz pak nemuze selhat
+	for ( unsigned int i = 0; i < no_surfaces && !reader.failed; ++i )
+	{
+		reader.GetString(); // nazev plochy
+		reader.GetString(); // nazev materialu
+		const unsigned int no_triangles = reader.Get<unsigned int>();
+
+		if ( no_triangles == 0 )
+		{
+			reader.failed = true;
+		}
+
+		if ( !indexed )
+		{
+			reader.Align( 16 );
+			reader.Read( sizeof( Triangle ) * static_cast<size_t>( no_triangles ) );
+			continue;
+		}
+
+		const unsigned int no_vertices = reader.Get<unsigned int>();
+		reader.Align( 16 );
+		reader.Read( ( sizeof( Vector3 ) * 2 + sizeof( Vector2 ) ) * static_cast<size_t>( no_vertices ) );
+		const unsigned int * indices = reinterpret_cast<const unsigned int *>( reader.Read( sizeof( unsigned int ) * 3 * static_cast<size_t>( no_triangles ) ) );
+
+		for ( size_t j = 0; indices != NULL && j < 3 * static_cast<size_t>( no_triangles ); ++j )
+		{
+			if ( indices[j] >= no_vertices )
+			{
+				reader.failed = true;
+				break;
+			}
+		}
+	}
+
+	if ( reader.failed )
+	{
+		printf( "Scene cache %s is corrupted, rebuilding.\n", cache_name );
+		Close();
+
+		return -1;
+	}
+
+	no_surfaces_ = static_cast<int>( no_surfaces );
+	indexed_ = indexed;
+
+	// obsah zdroju se nezmenil, jen cas - priste uz staci porovnat cas
+	UpdateSourceStamps( cache_name, stamps );
+
+	printf( "Loading scene cache '%s' (%0.1f MB)...\n", cache_name, file_.size() / SQR( 1024.0f ) );
+
+	return 0;
+}
+
+const std::vector<std::string> & SceneCache::material_libraries() const
+{
+	return material_libraries_;
+}
+
+int SceneCache::BuildSurfaces( std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+{
+	CacheReader reader = { file_.data(), file_.size(), surfaces_offset_, false };
+
+	for ( int i = 0; i < no_surfaces_; ++i )
+	{
+		const std::string name = reader.GetString();
+		const std::string material_name = reader.GetString();
+		const int no_triangles = static_cast<int>( reader.Get<unsigned int>() );
+
+		Surface * surface = NULL;
+
+		if ( indexed_ )
+		{
+			const size_t no_vertices = reader.Get<unsigned int>();
+			reader.Align( 16 );
+			const Vector3 * positions = reinterpret_cast<const Vector3 *>( reader.Read( sizeof( Vector3 ) * no_vertices ) );
+			const Vector3 * normals = reinterpret_cast<const Vector3 *>( reader.Read( sizeof( Vector3 ) * no_vertices ) );
+			const Vector2 * texture_coords = reinterpret_cast<const Vector2 *>( reader.Read( sizeof( Vector2 ) * no_vertices ) );
+			const unsigned int * indices = reinterpret_cast<const unsigned int *>( reader.Read( sizeof( unsigned int ) * 3 * no_triangles ) );
+
+			// tangenty se neukladaji, dopocitaji se ze svarenych vrcholu
+			std::vector<Vector3> surface_positions( positions, positions + no_vertices );
+			std::vector<Vector3> surface_normals( normals, normals + no_vertices );
+			std::vector<Vector2> surface_texture_coords( texture_coords, texture_coords + no_vertices );
+			std::vector<unsigned int> surface_indices( indices, indices + 3 * no_triangles );
+
+			surface = new Surface( name );
+			surface->set_indexed_mesh( surface_positions, surface_normals, surface_texture_coords, surface_indices );
+		}
+		else
+		{
+			reader.Align( 16 );
+			const char * triangles = reader.Read( sizeof( Triangle ) * no_triangles );
+
+			surface = new Surface( name, no_triangles );
+			memcpy( surface->get_triangles(), triangles, sizeof( Triangle ) * no_triangles );
+
+			// ukazatel na plochu v paddingu prvniho vertexu plati jen pro puvodni proces
+			for ( int j = 0; j < no_triangles; ++j )
+			{
+				surface->get_triangle( j ).set_surface( surface );
+			}
+		}
+
+		for ( int j = 0; j < static_cast<int>( materials.size() ); ++j )
+		{
+			if ( materials[j]->get_name().compare( material_name ) == 0 )
+			{
+				surface->set_material( materials[j] );
+				break;
+			}
+		}
+
+		surfaces.push_back( surface );
+	}
+
+	printf( "%d group(s)\nDone.\n\n", no_surfaces_ );
+
+	return no_surfaces_;
+}
+
+void SceneCache::Close()
+{
+	file_.Close();
+
+	material_libraries_.clear();
+	surfaces_offset_ = 0;
+	no_surfaces_ = 0;
+	indexed_ = false;
+}
+
+int SceneCache::Save( const char * cache_name, const char * obj_name, const std::vector<std::string> & material_libraries,
+	const Vector3 & default_color, const bool flip_yz, const bool indexed, std::vector<Surface *> & surfaces, const int first_surface )
+{
+	const std::string temp_name = std::string( cache_name ) + ".tmp";
+
+	FILE * file = fopen( temp_name.c_str(), "wb" );
+
+	if ( file == NULL )
+	{
+		printf( "Scene cache %s cannot be written.\n", cache_name );
+
+		return -1;
+	}
+
+	CacheWriter writer = { file, 0, false };
+
+	std::vector<std::string> sources( 1, std::string( obj_name ) );
+	sources.insert( sources.end(), material_libraries.begin(), material_libraries.end() );
+
+	writer.Write( scene_cache_magic, sizeof( scene_cache_magic ) );
+	writer.Put<unsigned int>( SCENE_CACHE_VERSION );
+	writer.Put<unsigned int>( sizeof( Triangle ) );
+	writer.Put<unsigned int>( sizeof( Vector3 ) );
+	writer.Put<unsigned int>( flip_yz ? 1 : 0 );
+	writer.Put<unsigned int>( indexed ? 1 : 0 );
+	writer.Put( default_color.x );
+	writer.Put( default_color.y );
+	writer.Put( default_color.z );
+	writer.Put( static_cast<unsigned int>( sources.size() ) );
+	writer.Put( static_cast<unsigned int>( material_libraries.size() ) );
+	writer.Put( static_cast<unsigned int>( surfaces.size() - first_surface ) );
+
+	for ( size_t i = 0; i < sources.size(); ++i )
+	{
+		unsigned long long size;
+		long long mtime;
+		GetFileStamp( sources[i], size, mtime );
+
+		writer.PutString( sources[i] );
+		writer.Put( size );
+		writer.Put( mtime );
+		writer.Put( HashFile( sources[i] ) );
+	}
+
+	for ( size_t i = 0; i < material_libraries.size(); ++i )
+	{
+		writer.PutString( material_libraries[i] );
+	}
+
+	writer.Align( 16 );
+
+	for ( size_t i = first_surface; i < surfaces.size(); ++i )
+	{
+		Surface * surface = surfaces[i];
+		const Material * material = surface->get_material();
+
+		writer.PutString( surface->get_name() );
+		writer.PutString( ( material != NULL ) ? material->get_name() : std::string() );
+		writer.Put( static_cast<unsigned int>( surface->no_triangles() ) );
+
+		if ( indexed )
+		{
+			const size_t no_vertices = surface->no_vertices();
+
+			writer.Put( static_cast<unsigned int>( no_vertices ) );
+			writer.Align( 16 );
+			// pozice bez vyplne w, pri nacteni se znovu rozlozi do zarovnaneho proudu
+			for ( size_t j = 0; j < no_vertices; ++j )
+			{
+				writer.Write( &surface->positions()[j], sizeof( Vector3 ) );
+			}
+
+			writer.Write( surface->normals(), sizeof( Vector3 ) * no_vertices );
+			writer.Write( surface->texture_coords(), sizeof( Vector2 ) * no_vertices );
+			writer.Write( surface->indices(), sizeof( unsigned int ) * 3 * surface->no_triangles() );
+		}
+		else
+		{
+			writer.Align( 16 );
+			writer.Write( surface->get_triangles(), sizeof( Triangle ) * surface->no_triangles() );
+		}
+	}
+
+	fclose( file );
+
+	if ( !writer.failed )
+	{
+		remove( cache_name );
+	}
+
+	if ( writer.failed || rename( temp_name.c_str(), cache_name ) != 0 )
+	{
+		printf( "Scene cache %s cannot be written.\n", cache_name );
+		remove( temp_name.c_str() );
+
+		return -1;
+	}
+
+	printf( "Scene cache written to '%s'.\n", cache_name );
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef SCENE_CACHE_H_
+#define SCENE_CACHE_H_
+
+/*! \class MappedFile
+\brief Soubor namapovany do pameti jen pro cteni.
+*/
+class MappedFile
+{
+public:
+	//! Vychozi konstruktor.
+	MappedFile();
+
+	//! Destruktor, odmapuje soubor.
+	~MappedFile();
+
+	//! Namapuje soubor \a file_name.
+	/*!
+	\return 0 pri uspechu, -1 pokud soubor neexistuje, je prazdny nebo ho nelze namapovat.
+	*/
+	int Open( const char * file_name );
+
+	//! Odmapuje a zavre soubor.
+	void Close();
+
+	const char * data() const;
+	size_t size() const;
+
+private:
+#ifdef _WIN32
+	void * file_; /*!< HANDLE souboru. */
+	void * mapping_; /*!< HANDLE mapovani. */
+#else
+	int file_; /*!< Deskriptor souboru. */
+#endif
+
+	const char * data_; /*!< Pocatek namapovaneho obsahu, NULL = zavreno. */
+	size_t size_; /*!< Velikost souboru [B]. */
+
+	DISALLOW_COPY_AND_ASSIGN( MappedFile );
+};
+
+/*! \fn void GetFileStamp( const std::string & file_name, unsigned long long & size, long long & mtime )
+\brief Velikost a cas posledni zmeny souboru, pro chybejici soubor nuly.
+*/
+void GetFileStamp( const std::string & file_name, unsigned long long & size, long long & mtime );
+
+/*! \fn unsigned long long HashFile( const std::string & file_name )
+\brief 64-bitovy FNV-1a hash obsahu souboru.
+*/
+unsigned long long HashFile( const std::string & file_name );
+
+/*! \class SceneCache
+\brief Binarni cache ploch nactenych z OBJ souboru.
+
+Soubor obsahuje hotove plochy (nazev, nazev materialu a pole trojuhelniku
+v pametove podobe tridy Triangle), takze nacteni je jedno namapovani a
+jedno kopirovani pole na plochu misto parsovani textu. Materialy se
+ukladaji jen odkazem (nazvem), MTL knihovny jsou male a nacitaji se
+s texturami znovu pres LoadMTL.
+
+Indexovane plochy se ukladaji jako proudy pozic, normal a texturovacich
+souradnic svarenych vrcholu a trojice indexu.
+
+Cache je platna, pokud se shoduje verze formatu, velikost Triangle a Vector3,
+vychozi barva, flip_yz, rezim indexovanych ploch a vsechny zdrojove soubory (OBJ i MTL). Zdroj se
+shoduje, ma-li stejnou velikost a cas posledni zmeny; pri jinem case
+(napr. novy checkout) se porovna jeste 64-bitovy FNV-1a hash obsahu a pri
+shode se novy cas zapise do cache, aby se hash priste nepocital znovu.
+*/
+class SceneCache
+{
+public:
+	//! Vychozi konstruktor.
+	SceneCache();
+
+	//! Namapuje cache \a cache_name a overi ji proti zdrojum a parametrum nacitani.
+	/*!
+	\return 0 pri platne cache, -1 pokud chybi, je poskozena nebo zastarala.
+	*/
+	int Open( const char * cache_name, const Vector3 & default_color, const bool flip_yz, const bool indexed );
+
+	//! Uplne cesty k MTL knihovnam ulozenym v cache.
+	const std::vector<std::string> & material_libraries() const;
+
+	//! Vytvori plochy z otevrene cache a priradi jim materialy podle nazvu z \a materials.
+	/*!
+	\return Pocet pridanych ploch.
+	*/
+	int BuildSurfaces( std::vector<Surface *> & surfaces, std::vector<Material *> & materials );
+
+	//! Zavre cache.
+	void Close();
+
+	//! Ulozi plochy surfaces[first_surface..] nactene z \a obj_name a \a material_libraries.
+	/*!
+	Zapisuje se do docasneho souboru, ktery se az nakonec prejmenuje na \a cache_name.
+
+	\return 0 pri uspechu, -1 pri chybe.
+	*/
+	static int Save( const char * cache_name, const char * obj_name, const std::vector<std::string> & material_libraries,
+		const Vector3 & default_color, const bool flip_yz, const bool indexed, std::vector<Surface *> & surfaces, const int first_surface );
+
+private:
+	MappedFile file_; /*!< Namapovana cache. */
+	std::vector<std::string> material_libraries_; /*!< MTL knihovny zdrojoveho OBJ. */
+	size_t surfaces_offset_; /*!< Pozice prvni plochy v souboru. */
+	int no_surfaces_; /*!< Pocet ploch v cache. */
+	bool indexed_; /*!< Plochy jsou ulozene indexovane. */
+
+	DISALLOW_COPY_AND_ASSIGN( SceneCache );
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "stdafx.h"
+
+// realne SH pro l <= 2 bez konstant, poradi (0,0), (1,-1), (1,0), (1,1), (2,-2), (2,-1), (2,0), (2,1), (2,2)
+static void EvaluatePolynomials( const Vector3 & d, float * p )
+{
+	p[0] = 1.0f;
+	p[1] = d.y;
+	p[2] = d.z;
+	p[3] = d.x;
+	p[4] = d.x * d.y;
+	p[5] = d.y * d.z;
+	p[6] = 3 * SQR( d.z ) - 1;
+	p[7] = d.x * d.z;
+	p[8] = SQR( d.x ) - SQR( d.y );
+}
+
+static const float sh_constants[SH_MAX_COEFFICIENTS] = {
+	0.282095f,
+	0.488603f, 0.488603f, 0.488603f,
+	1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+
+// konvoluce s max(cos, 0) vydelena pi: A0 = pi, A1 = 2pi/3, A2 = pi/4
+static const float sh_bands[SH_MAX_BANDS] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+SHIrradiance::SHIrradiance()
+{
+	no_bands_ = 0;
+
+	for ( int i = 0; i < SH_MAX_COEFFICIENTS; ++i )
+	{
+		coefficients_[i] = Vector3( 0, 0, 0 );
+	}
+}
+
+int SHIrradiance::no_bands() const
+{
+	return no_bands_;
+}
+
+int SHIrradiance::Project( CubeMap & cube_map, const int no_bands )
+{
+	for ( int face = 0; face < CUBEMAP_FACES; ++face )
+	{
+		if ( cube_map.GetFace( face ) == NULL )
+		{
+			printf( "Cube map %s is incomplete, no SH irradiance.\n", cube_map.GetPath().c_str() );
+
+			return -1;
+		}
+	}
+
+	no_bands_ = MAX( 1, MIN( no_bands, SH_MAX_BANDS ) );
+
+	double sums[CUBEMAP_FACES][SH_MAX_COEFFICIENTS][3];
+
+	// kazda stena do vlastnich souctu, sectene az nakonec (vysledek nezavisi na poctu vlaken)
+#pragma omp parallel for schedule( dynamic )
+	for ( int face = 0; face < CUBEMAP_FACES; ++face )
+	{
+		Texture * texture = cube_map.GetFace( face );
+		const int width = texture->width();
+		const int height = texture->height();
+
+		for ( int i = 0; i < SH_MAX_COEFFICIENTS; ++i )
+		{
+			sums[face][i][0] = sums[face][i][1] = sums[face][i][2] = 0;
+		}
+
+		for ( int y = 0; y < height; ++y )
+		{
+			for ( int x = 0; x < width; ++x )
+			{
+				// get_texel v (x / width, y / height) vraci presne texel (x, y)
+				const float u = x / static_cast<float>( width );
+				const float v = y / static_cast<float>( height );
+				const Color4 texel = texture->get_texel( u, v );
+
+				// prostorovy uhel texelu na stene [-1, 1]^2 ve vzdalenosti 1
+				const float a = 2 * ( x + 0.5f ) / width - 1;
+				const float b = 2 * ( y + 0.5f ) / height - 1;
+				const float r2 = 1 + SQR( a ) + SQR( b );
+				const float solid_angle = 4.0f / ( width * height * r2 * sqrt( r2 ) );
+
+				Vector3 d = CubeMap::FaceToDirection( face, ( x + 0.5f ) / width, ( y + 0.5f ) / height );
+				d.Normalize();
+
+				float p[SH_MAX_COEFFICIENTS];
+				EvaluatePolynomials( d, p );
+
+				for ( int i = 0; i < SQR( no_bands_ ); ++i )
+				{
+					const float w = p[i] * solid_angle;
+
+					sums[face][i][0] += texel.r * w;
+					sums[face][i][1] += texel.g * w;
+					sums[face][i][2] += texel.b * w;
+				}
+			}
+		}
+	}
+
+	for ( int i = 0; i < SH_MAX_COEFFICIENTS; ++i )
+	{
+		double c[3] = { 0, 0, 0 };
+
+		for ( int face = 0; face < CUBEMAP_FACES; ++face )
+		{
+			c[0] += sums[face][i][0];
+			c[1] += sums[face][i][1];
+			c[2] += sums[face][i][2];
+		}
+
+		// L_lm = K_lm * soucet, pri vyhodnoceni znovu K_lm a konvoluce A_l / pi
+		const int band = ( i == 0 ) ? 0 : ( ( i < 4 ) ? 1 : 2 );
+		const float scale = ( i < SQR( no_bands_ ) ) ? SQR( sh_constants[i] ) * sh_bands[band] : 0.0f;
+
+		coefficients_[i] = Vector3( static_cast<float>( c[0] ), static_cast<float>( c[1] ), static_cast<float>( c[2] ) ) * scale;
+	}
+
+	return 0;
+}
+
+Vector3 SHIrradiance::GetIrradiance( const Vector3 & normal ) const
+{
+	float p[SH_MAX_COEFFICIENTS];
+	EvaluatePolynomials( normal, p );
+
+	Vector3 irradiance = coefficients_[0];
+
+	for ( int i = 1; i < SQR( no_bands_ ); ++i )
+	{
+		irradiance += coefficients_[i] * p[i];
+	}
+
+	return irradiance;
+}
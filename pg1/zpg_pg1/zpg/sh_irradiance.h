@@ -0,0 +1,43 @@
+#ifndef SH_IRRADIANCE_H_
+#define SH_IRRADIANCE_H_
+
+#define SH_MAX_BANDS 3 // pasma l = 0, 1, 2, tj. 9 koeficientu
+#define SH_MAX_COEFFICIENTS ( SH_MAX_BANDS * SH_MAX_BANDS )
+
+/*! \class SHIrradiance
+\brief Difuzni ozareni cube mapy v bazi sferickych harmonik (Ramamoorthi, Hanrahan 2001).
+
+Prostredi se jednou promitne do prvnich dvou nebo tri pasem SH (paralelne
+pres steny cube mapy). Konvoluce s kosinovym lalokem je v SH jen nasobeni
+koeficientu konstantou pasma, takze ozareni pro libovolnou normalu stoji
+nekolik nasobeni a scitani.
+
+Vysledek je ozareni vydelene pi, tj. radiance odrazena bilou lambertovskou
+plochou, ve stejnych jednotkach jako CubeMap::GetTexel.
+*/
+class SHIrradiance
+{
+public:
+	//! Vychozi konstruktor, nulove ozareni.
+	SHIrradiance();
+
+	//! Promitne cube mapu do \a no_bands pasem SH.
+	/*!
+	\param cube_map zdrojova cube mapa.
+	\param no_bands pocet pasem, 2 (4 koeficienty) nebo 3 (9 koeficientu).
+	\return 0 pri uspechu, -1 pokud cube mapa nema vsechny steny.
+	*/
+	int Project( CubeMap & cube_map, const int no_bands = SH_MAX_BANDS );
+
+	//! Ozareni / pi pro normalu \a normal (jednotkovy vektor).
+	Vector3 GetIrradiance( const Vector3 & normal ) const;
+
+	//! Pocet pasem.
+	int no_bands() const;
+
+private:
+	int no_bands_; /*!< Pocet pouzitych pasem. */
+	Vector3 coefficients_[SH_MAX_COEFFICIENTS]; /*!< RGB koeficienty vcetne konvoluce, normovani bazi a 1/pi. */
+};
+
+#endif
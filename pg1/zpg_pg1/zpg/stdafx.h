@@ -3,6 +3,8 @@
 #define ALIGNMENT 16
 #define ALIGN __declspec( align( ALIGNMENT ) )
 
+#define CACHE_LINE_SIZE 64
+
 #include "targetver.h"
 
 #define NOMINMAX
@@ -13,10 +15,21 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <float.h>
+#include <emmintrin.h>
 #include <vector>
+#include <array>
 #include <set>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
 #include <random>
 #include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 
 // visual leak detector 2.5
 //#include <vld.h>
@@ -55,6 +68,7 @@
 #include "matrix4x4.h"
 #include "quaternion.h"
 #include "color4.h"
+#include "quantization.h"
 
 #include "omnilight.h"
 #include "texture.h"
@@ -66,8 +80,23 @@
 #include "ray.h"
 
 #include "objloader.h"
+#include "scene_cache.h"
 
 #include "camera.h"
 #include "CubeMap.h"
 
+#include "tile_scheduler.h"
+#include "framebuffer.h"
+#include "tiled_image_writer.h"
+#include "preview.h"
+#include "wavefront.h"
+#include "sampler.h"
+#include "prefiltered_environment.h"
+#include "sh_irradiance.h"
+#include "environment_sampler.h"
+#include "gbuffer.h"
+#include "material_matrix.h"
+#include "denoiser.h"
+#include "output_sink.h"
+
 #include "ggx_distribution.h"
@@ -24,6 +24,9 @@ Surface::Surface()
 {
 	n_ = 0;
 	triangles_ = NULL;
+	positions_ = NULL;
+	no_vertices_ = 0;
+	material_ = NULL;
 }
 
 Surface::Surface( const std::string & name, const int n )
@@ -34,11 +37,32 @@ Surface::Surface( const std::string & name, const int n )
 
 	n_ = n;
 	triangles_ = new Triangle[n_];
+	positions_ = NULL;
+	no_vertices_ = 0;
+	material_ = NULL;
+}
+
+Surface::Surface( const std::string & name )
+{
+	name_ = name;
+
+	n_ = 0;
+	triangles_ = NULL;
+	positions_ = NULL;
+	no_vertices_ = 0;
+	material_ = NULL;
 }
 
 Surface::~Surface()
 {
 	SAFE_DELETE_ARRAY( triangles_ );
+
+	if ( positions_ != NULL )
+	{
+		_mm_free( positions_ );
+		positions_ = NULL;
+	}
+
 	n_ = 0;
 }
 
@@ -52,6 +76,222 @@ Triangle * Surface::get_triangles()
 	return triangles_;
 }
 
+void Surface::set_indexed_mesh( const std::vector<Vector3> & positions, std::vector<Vector3> & normals,
+	std::vector<Vector2> & texture_coords, std::vector<unsigned int> & indices )
+{
+	assert( triangles_ == NULL && positions_ == NULL && indices.size() % 3 == 0 );
+	assert( normals.size() == positions.size() && texture_coords.size() == positions.size() );
+
+	// tvrt sloka je vpl, dky n lze za z poslednho vrcholu st, a kad pozice je zarovnan
+	positions_ = static_cast<Vector4 *>( _mm_malloc( sizeof( Vector4 ) * MAX( positions.size(), size_t( 1 ) ), ALIGNMENT ) );
+
+	for ( size_t i = 0; i < positions.size(); ++i )
+	{
+		positions_[i] = Vector4( positions[i] );
+	}
+
+	no_vertices_ = static_cast<int>( positions.size() );
+	normals_.swap( normals );
+	texture_coords_.swap( texture_coords );
+	indices_.swap( indices );
+
+	n_ = static_cast<int>( indices_.size() / 3 );
+
+	// tangenta trojhelnka stejn jako v konstruktoru Triangle, do vrchol se st
+	tangents_.assign( no_vertices_, Vector3( 0.0f, 0.0f, 0.0f ) );
+
+	for ( int i = 0; i < n_; ++i )
+	{
+		const unsigned int * t = &indices_[i * 3];
+
+		const Vector3 e1 = vertex_position( i, 1 ) - vertex_position( i, 0 );
+		const Vector3 e2 = vertex_position( i, 2 ) - vertex_position( i, 0 );
+		const Vector2 duv1 = texture_coords_[t[1]] - texture_coords_[t[0]];
+		const Vector2 duv2 = texture_coords_[t[2]] - texture_coords_[t[0]];
+		const float rd = 1 / ( duv1.x * duv2.y - duv1.y * duv2.x );
+		Vector3 tangent = ( e1 * duv2.y - e2 * duv1.y ) * rd;
+		tangent.Normalize();
+
+		// degenerovan texturovac souadnice by prmr znehodnotily
+		if ( tangent.x == tangent.x && tangent.y == tangent.y && tangent.z == tangent.z )
+		{
+			for ( int j = 0; j < 3; ++j )
+			{
+				tangents_[t[j]] += tangent;
+			}
+		}
+	}
+
+	for ( size_t i = 0; i < tangents_.size(); ++i )
+	{
+		tangents_[i].Normalize();
+	}
+}
+
+void Surface::Quantize()
+{
+	if ( !indexed() || quantized() )
+	{
+		return;
+	}
+
+	packed_normals_.resize( no_vertices_ );
+	packed_tangents_.resize( no_vertices_ );
+	packed_texture_coords_.resize( no_vertices_ );
+
+	for ( int i = 0; i < no_vertices_; ++i )
+	{
+		packed_normals_[i] = EncodeOctahedral( normals_[i] );
+		packed_tangents_[i] = EncodeOctahedral( tangents_[i] );
+		packed_texture_coords_[i] = EncodeHalf2( texture_coords_[i] );
+	}
+
+	// swap s przdnm vektorem opravdu uvoln pam
+	std::vector<Vector3>().swap( normals_ );
+	std::vector<Vector3>().swap( tangents_ );
+	std::vector<Vector2>().swap( texture_coords_ );
+}
+
+bool Surface::quantized() const
+{
+	return !packed_normals_.empty();
+}
+
+bool Surface::indexed() const
+{
+	return triangles_ == NULL && n_ > 0;
+}
+
+const Vector4 * Surface::positions() const
+{
+	return positions_;
+}
+
+const Vector3 * Surface::normals() const
+{
+	return normals_.data();
+}
+
+const Vector2 * Surface::texture_coords() const
+{
+	return texture_coords_.data();
+}
+
+const Vector3 * Surface::tangents() const
+{
+	return tangents_.data();
+}
+
+const unsigned int * Surface::indices() const
+{
+	return indices_.data();
+}
+
+Vector3 Surface::vertex_position( const int i, const int j )
+{
+	if ( triangles_ != NULL )
+	{
+		return triangles_[i].vertex( j ).position;
+	}
+
+	const Vector4 & position = positions_[indices_[i * 3 + j]];
+
+	return Vector3( position.x, position.y, position.z );
+}
+
+Vector3 Surface::normal( const int i, const float u, const float v )
+{
+	if ( triangles_ != NULL )
+	{
+		return triangles_[i].normal( u, v );
+	}
+
+	const unsigned int * t = &indices_[i * 3];
+
+	if ( quantized() )
+	{
+		return InterpolateOctahedral( packed_normals_[t[0]], packed_normals_[t[1]], packed_normals_[t[2]], u, v );
+	}
+
+	Vector3 normal = u * normals_[t[1]] +
+		v * normals_[t[2]] +
+		( 1.0f - u - v ) * normals_[t[0]];
+	normal.Normalize();
+
+	return normal;
+}
+
+Vector2 Surface::texture_coord( const int i, const float u, const float v )
+{
+	if ( triangles_ != NULL )
+	{
+		return triangles_[i].texture_coord( u, v );
+	}
+
+	const unsigned int * t = &indices_[i * 3];
+
+	if ( quantized() )
+	{
+		return InterpolateHalf2( packed_texture_coords_[t[0]], packed_texture_coords_[t[1]], packed_texture_coords_[t[2]], u, v );
+	}
+
+	return u * texture_coords_[t[1]] +
+		v * texture_coords_[t[2]] +
+		( 1.0f - u - v ) * texture_coords_[t[0]];
+}
+
+Vector3 Surface::tangent( const int i, const float u, const float v )
+{
+	Vector3 tangent;
+
+	if ( triangles_ != NULL )
+	{
+		tangent = u * triangles_[i].vertex( 1 ).tangent +
+			v * triangles_[i].vertex( 2 ).tangent +
+			( 1.0f - u - v ) * triangles_[i].vertex( 0 ).tangent;
+	}
+	else
+	{
+		const unsigned int * t = &indices_[i * 3];
+
+		if ( quantized() )
+		{
+			return InterpolateOctahedral( packed_tangents_[t[0]], packed_tangents_[t[1]], packed_tangents_[t[2]], u, v );
+		}
+
+		tangent = u * tangents_[t[1]] +
+			v * tangents_[t[2]] +
+			( 1.0f - u - v ) * tangents_[t[0]];
+	}
+
+	tangent.Normalize();
+
+	return tangent;
+}
+
+const void * Surface::vertex_buffer() const
+{
+	// Triangle obsahuje jen ti Vertex, pozice je jejich prvn slokou a za n nsleduje normla
+	return ( triangles_ != NULL ) ? static_cast<const void *>( triangles_ ) : static_cast<const void *>( positions_ );
+}
+
+size_t Surface::vertex_stride() const
+{
+	return ( triangles_ != NULL ) ? sizeof( Vertex ) : sizeof( Vector4 );
+}
+
+size_t Surface::memory_size() const
+{
+	if ( triangles_ != NULL )
+	{
+		return sizeof( Triangle ) * n_;
+	}
+
+	const size_t attributes = quantized() ? sizeof( unsigned int ) * 3 : sizeof( Vector3 ) * 2 + sizeof( Vector2 );
+
+	return ( sizeof( Vector4 ) + attributes ) * no_vertices_ + sizeof( unsigned int ) * indices_.size();
+}
+
 std::string Surface::get_name()
 {
 	return name_;
@@ -64,7 +304,7 @@ int Surface::no_triangles()
 
 int Surface::no_vertices()
 {
-	return 3 * n_;
+	return ( triangles_ != NULL ) ? 3 * n_ : no_vertices_;
 }
 
 Matrix4x4 * Surface::transformation()
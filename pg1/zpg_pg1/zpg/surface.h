@@ -26,6 +26,14 @@ public:
 	*/
 	Surface( const std::string & name, const int n );
 
+	//! Konstruktor indexovan st.
+	/*!
+	S zatm nem dn trojhelnky, vrcholy a indexy se pedaj pes set_indexed_mesh.
+
+	\param name nzev plochy.
+	*/
+	explicit Surface( const std::string & name );
+
 	//! Destruktor.
 	/*!
 	Uvoln vechny alokovan zdroje.
@@ -45,6 +53,109 @@ public:
 	*/
 	Triangle * get_triangles();
 
+	//! Pevezme svaen vrcholy a indexy trojhelnk indexovan st.
+	/*!
+	Obsah vektor norml, texturovacch souadnic a index se vymn s vnitnmi proudy,
+	vstupn vektory zstanou przdn. Pozice se zkopruj do proudu Vector4 zarovnanho
+	na 16 byt, kter Embree te pmo. Tangenty vrchol se dopotou jako prmr tangent
+	pilehlch trojhelnk.
+
+	\param positions pozice vrchol.
+	\param normals normly vrchol.
+	\param texture_coords texturovac souadnice vrchol.
+	\param indices trojice index vrchol pro kad trojhelnk.
+	*/
+	void set_indexed_mesh( const std::vector<Vector3> & positions, std::vector<Vector3> & normals,
+		std::vector<Vector2> & texture_coords, std::vector<unsigned int> & indices );
+
+	//! Je s uloena indexovan?
+	/*!
+	\return true pro proudy atribut a indexy, false pro pole trojhelnk.
+	*/
+	bool indexed() const;
+
+	//! Nahrad float normly, tangenty a texturovac souadnice indexovan st kompaktnm kdovnm.
+	/*!
+	Normly a tangenty se ulo osmistnn do 32 bit, texturovac souadnice jako dvojice half,
+	tj. 12 byt na vrchol msto 32. Float proudy se uvoln, normal, tangent a texture_coord
+	pak dekduj SIMD pmo z kompaktnch proud.
+	*/
+	void Quantize();
+
+	//! Jsou atributy indexovan st kvantovan?
+	bool quantized() const;
+
+	//! Pozice vrchol indexovan st, w = 1.
+	const Vector4 * positions() const;
+
+	//! Normly vrchol indexovan st, NULL po Quantize.
+	const Vector3 * normals() const;
+
+	//! Texturovac souadnice vrchol indexovan st, NULL po Quantize.
+	const Vector2 * texture_coords() const;
+
+	//! Tangenty vrchol indexovan st, NULL po Quantize.
+	const Vector3 * tangents() const;
+
+	//! Trojice index vrchol indexovan st.
+	const unsigned int * indices() const;
+
+	//! Pozice vrcholu trojhelnka v obou reimech.
+	/*!
+	\param i index trojhelnka.
+	\param j index vrcholu trojhelnka.
+	\return Pozice vrcholu.
+	*/
+	Vector3 vertex_position( const int i, const int j );
+
+	//! Interpolovan normla trojhelnka v obou reimech, stejn jako Triangle::normal.
+	/*!
+	\param i index trojhelnka.
+	\param u baricentrick souadnice.
+	\param v baricentrick souadnice.
+	\return Normalizovan normla.
+	*/
+	Vector3 normal( const int i, const float u, const float v );
+
+	//! Interpolovan texturovac souadnice trojhelnka v obou reimech.
+	/*!
+	\param i index trojhelnka.
+	\param u baricentrick souadnice.
+	\param v baricentrick souadnice.
+	\return Texturovac souadnice.
+	*/
+	Vector2 texture_coord( const int i, const float u, const float v );
+
+	//! Interpolovan normalizovan tangenta trojhelnka v obou reimech.
+	/*!
+	\param i index trojhelnka.
+	\param u baricentrick souadnice.
+	\param v baricentrick souadnice.
+	\return Normalizovan tangenta.
+	*/
+	Vector3 tangent( const int i, const float u, const float v );
+
+	//! Pozice prvnho vrcholu pro sdlen vertex buffer Embree.
+	/*!
+	V obou reimech jsou za slokou z poslednho vrcholu jet alespo 4 iteln byty,
+	jak to rtcSetBuffer vyaduje.
+
+	\return Ukazatel na x prvn pozice.
+	*/
+	const void * vertex_buffer() const;
+
+	//! Vzdlenost dvou po sob jdoucch pozic ve vertex_buffer.
+	/*!
+	\return sizeof( Vertex ) pro pole trojhelnk, sizeof( Vector4 ) pro indexovanou s.
+	*/
+	size_t vertex_stride() const;
+
+	//! Velikost geometrie st v pamti.
+	/*!
+	\return Poet byt trojhelnk, resp. proud atribut a index.
+	*/
+	size_t memory_size() const;
+
 	//! Vrt nzev plochy.
 	/*!	
 	\return Nzev plochy.
@@ -85,7 +196,18 @@ protected:
 
 private:
 	int n_; /*!< Poet trojhelnk v sti. */	
-	Triangle * triangles_; /*!< Trojhelnkov s. */
+	Triangle * triangles_; /*!< Trojhelnkov s, NULL pro indexovanou s. */
+
+	Vector4 * positions_; /*!< Pozice svaench vrchol indexovan st zarovnan na 16 byt, sdlen s Embree. */
+	std::vector<Vector3> normals_; /*!< Normly vrchol. */
+	std::vector<Vector2> texture_coords_; /*!< Texturovac souadnice vrchol. */
+	std::vector<Vector3> tangents_; /*!< Tangenty vrchol. */
+	std::vector<unsigned int> indices_; /*!< Ti indexy vrchol na trojhelnk. */
+	int no_vertices_; /*!< Poet svaench vrchol indexovan st. */
+
+	std::vector<unsigned int> packed_normals_; /*!< Osmistnn kdovan normly po Quantize. */
+	std::vector<unsigned int> packed_tangents_; /*!< Osmistnn kdovan tangenty po Quantize. */
+	std::vector<unsigned int> packed_texture_coords_; /*!< Texturovac souadnice jako dvojice half po Quantize. */
 	
 	std::string name_; /*!< Nzev plochy. */
 
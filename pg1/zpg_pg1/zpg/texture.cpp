@@ -85,6 +85,39 @@ Color4 Texture::get_texel( const float u, const float v )
 		static_cast<float>( 1.0 / 255.0 );
 }
 
+Texture * Texture::Downsample() const
+{
+	Texture * texture = new Texture();
+
+	texture->pixel_size_ = pixel_size_;
+	texture->width_ = MAX( 1, width_ / 2 );
+	texture->height_ = MAX( 1, height_ / 2 );
+	texture->row_size_ = texture->width_ * pixel_size_;
+	texture->data_ = new unsigned char[texture->row_size_ * texture->height_];
+
+	for ( int y = 0; y < texture->height_; ++y )
+	{
+		const int y0 = MIN( 2 * y, height_ - 1 );
+		const int y1 = MIN( 2 * y + 1, height_ - 1 );
+
+		for ( int x = 0; x < texture->width_; ++x )
+		{
+			const int x0 = MIN( 2 * x, width_ - 1 );
+			const int x1 = MIN( 2 * x + 1, width_ - 1 );
+
+			for ( int c = 0; c < pixel_size_; ++c )
+			{
+				const int sum = data_[x0 * pixel_size_ + y0 * row_size_ + c] + data_[x1 * pixel_size_ + y0 * row_size_ + c] +
+					data_[x0 * pixel_size_ + y1 * row_size_ + c] + data_[x1 * pixel_size_ + y1 * row_size_ + c];
+
+				texture->data_[x * pixel_size_ + y * texture->row_size_ + c] = static_cast<unsigned char>( ( sum + 2 ) / 4 );
+			}
+		}
+	}
+
+	return texture;
+}
+
 Texture * LoadTexture( const char * file_name, const int flip, const bool single_channel )
 {
 	cv::Mat image_bgr = ( single_channel )?
@@ -59,6 +59,12 @@ public:
 	*/
 	Color4 get_texel( const float u, const float v );
 
+	//! Vytvori texturu polovicniho rozliseni prumerovanim bloku 2x2 (dalsi uroven mipmapy).
+	/*!
+	\return Nova textura, uvolnuje ji volajici.
+	*/
+	Texture * Downsample() const;
+
 protected:
 
 private:
@@ -0,0 +1,192 @@
+#include "stdafx.h"
+
+static unsigned long long PackRange( const unsigned int begin, const unsigned int end )
+{
+	return ( static_cast<unsigned long long>( begin ) << 32 ) | end;
+}
+
+static void UnpackRange( const unsigned long long range, unsigned int & begin, unsigned int & end )
+{
+	begin = static_cast<unsigned int>( range >> 32 );
+	end = static_cast<unsigned int>( range & 0xFFFFFFFFull );
+}
+
+void HilbertD2XY( const int n, const int d, int & x, int & y )
+{
+	int t = d;
+
+	x = 0;
+	y = 0;
+
+	for ( int s = 1; s < n; s *= 2 )
+	{
+		const int rx = 1 & ( t / 2 );
+		const int ry = 1 & ( t ^ rx );
+
+		// rotace kvadrantu
+		if ( ry == 0 )
+		{
+			if ( rx == 1 )
+			{
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+
+			utils::swap( x, y );
+		}
+
+		x += s * rx;
+		y += s * ry;
+		t /= 4;
+	}
+}
+
+TileScheduler::TileScheduler( const int width, const int height, const int tile_size )
+{
+	assert( ( tile_size > 0 ) && ( tile_size % 4 == 0 ) );
+
+	const int no_tiles_x = ( width + tile_size - 1 ) / tile_size;
+	const int no_tiles_y = ( height + tile_size - 1 ) / tile_size;
+
+	int n = 1;
+	while ( ( n < no_tiles_x ) || ( n < no_tiles_y ) )
+	{
+		n *= 2;
+	}
+
+	tiles_.reserve( no_tiles_x * no_tiles_y );
+
+	// projdeme Hilbertovu krivku nad nejmensi ctvercovou mrizkou a vynechame dlazdice mimo obraz
+	for ( int d = 0; d < n * n; ++d )
+	{
+		int tx, ty;
+		HilbertD2XY( n, d, tx, ty );
+
+		if ( ( tx < no_tiles_x ) && ( ty < no_tiles_y ) )
+		{
+			Tile tile;
+			tile.x0 = tx * tile_size;
+			tile.y0 = ty * tile_size;
+			tile.x1 = MIN( width, tile.x0 + tile_size );
+			tile.y1 = MIN( height, tile.y0 + tile_size );
+			tile.index = static_cast<int>( tiles_.size() );
+
+			tiles_.push_back( tile );
+		}
+	}
+
+	queues_ = NULL;
+	no_queues_ = 0;
+}
+
+TileScheduler::~TileScheduler()
+{
+	SAFE_DELETE_ARRAY( queues_ );
+	no_queues_ = 0;
+}
+
+int TileScheduler::no_tiles() const
+{
+	return static_cast<int>( tiles_.size() );
+}
+
+const Tile & TileScheduler::tile( const int i ) const
+{
+	return tiles_[i];
+}
+
+void TileScheduler::Reset( const int no_threads )
+{
+	assert( no_threads > 0 );
+
+	if ( no_queues_ != no_threads )
+	{
+		SAFE_DELETE_ARRAY( queues_ );
+		queues_ = new WorkQueue[no_threads];
+		no_queues_ = no_threads;
+	}
+
+	// kazde vlakno dostane souvisly usek krivky, sousedni dlazdice tak zpracuje stejne vlakno
+	const int n = no_tiles();
+
+	for ( int i = 0; i < no_queues_; ++i )
+	{
+		const unsigned int begin = static_cast<unsigned int>( ( static_cast<long long>( n ) * i ) / no_queues_ );
+		const unsigned int end = static_cast<unsigned int>( ( static_cast<long long>( n ) * ( i + 1 ) ) / no_queues_ );
+
+		queues_[i].range.store( PackRange( begin, end ) );
+	}
+}
+
+bool TileScheduler::Pop( const int thread_id, Tile & tile )
+{
+	std::atomic<unsigned long long> & range = queues_[thread_id].range;
+	unsigned long long old_range = range.load();
+
+	for ( ; ; )
+	{
+		unsigned int begin, end;
+		UnpackRange( old_range, begin, end );
+
+		if ( begin >= end )
+		{
+			return false;
+		}
+
+		if ( range.compare_exchange_weak( old_range, PackRange( begin + 1, end ) ) )
+		{
+			tile = tiles_[begin];
+
+			return true;
+		}
+	}
+}
+
+bool TileScheduler::Steal( const int thread_id )
+{
+	// obeti zkousime postupne za sebou, abychom nezacinali vsichni u stejneho vlakna
+	for ( int k = 1; k < no_queues_; ++k )
+	{
+		std::atomic<unsigned long long> & victim = queues_[( thread_id + k ) % no_queues_].range;
+		unsigned long long old_range = victim.load();
+
+		for ( ; ; )
+		{
+			unsigned int begin, end;
+			UnpackRange( old_range, begin, end );
+
+			if ( begin >= end )
+			{
+				break;
+			}
+
+			// ukradneme zadni polovinu useku, obeti zustane predni cast navazujici na jeji praci
+			const unsigned int middle = begin + ( end - begin ) / 2;
+
+			if ( victim.compare_exchange_weak( old_range, PackRange( begin, middle ) ) )
+			{
+				// nase fronta je prazdna, nikdo jiny do ni nezapisuje
+				queues_[thread_id].range.store( PackRange( middle, end ) );
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool TileScheduler::Next( const int thread_id, Tile & tile )
+{
+	assert( ( thread_id >= 0 ) && ( thread_id < no_queues_ ) );
+
+	while ( !Pop( thread_id, tile ) )
+	{
+		if ( !Steal( thread_id ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,111 @@
+#ifndef TILE_SCHEDULER_H_
+#define TILE_SCHEDULER_H_
+
+/*! \def TILE_SHIFT
+\brief Dvojkovy logaritmus velikosti dlazdice, alespon 4 (TIFF dlazdice jsou nasobkem 16).
+*/
+#define TILE_SHIFT 4
+
+/*! \def TILE_SIZE
+\brief Vychozi velikost dlazdice obrazu [px], mocnina dvou kvuli indexovani Framebuffer.
+*/
+#define TILE_SIZE ( 1 << TILE_SHIFT )
+
+/*! \struct Tile
+\brief Obdelnikova dlazdice obrazu <x0, x1) x <y0, y1).
+*/
+struct Tile
+{
+	int x0; /*!< Levy okraj dlazdice [px]. */
+	int y0; /*!< Horni okraj dlazdice [px]. */
+	int x1; /*!< Pravy okraj dlazdice (bez) [px]. */
+	int y1; /*!< Dolni okraj dlazdice (bez) [px]. */
+	int index; /*!< Poradi dlazdice na Hilbertove krivce. */
+};
+
+/*! \class TileScheduler
+\brief Planovac dlazdic obrazu s work-stealing frontami.
+
+Dlazdice jsou serazeny podel Hilbertovy krivky a rozdeleny na souvisle
+useky mezi vlakna. Kazde vlakno odebira dlazdice z cela sve fronty, po jejim
+vycerpani ukradne polovinu zbyvajicich dlazdic jinemu vlaknu. Fronta je jedno
+64-bitove atomicke slovo <begin, end), takze se nikde nezamyka.
+*/
+class TileScheduler
+{
+public:
+	//! Obecny konstruktor.
+	/*!
+	\param width sirka obrazu [px].
+	\param height vyska obrazu [px].
+	\param tile_size velikost dlazdice [px].
+	*/
+	TileScheduler( const int width, const int height, const int tile_size = TILE_SIZE );
+
+	//! Destruktor.
+	~TileScheduler();
+
+	//! Pocet dlazdic obrazu.
+	int no_tiles() const;
+
+	//! I-ta dlazdice v poradi Hilbertovy krivky.
+	const Tile & tile( const int i ) const;
+
+	//! Rozdeli vsechny dlazdice rovnomerne mezi \a no_threads front.
+	void Reset( const int no_threads );
+
+	//! Vrati dalsi dlazdici pro vlakno \a thread_id.
+	/*!
+	\return False pokud uz nezbyva zadna dlazdice ani k ukradeni.
+	*/
+	bool Next( const int thread_id, Tile & tile );
+
+	//! Zpracuje vsechny dlazdice v jedine paralelni oblasti.
+	/*!
+	\param kernel funktor volany jako kernel( tile, thread_id ).
+	*/
+	template<class Kernel> void Run( Kernel kernel )
+	{
+		Reset( omp_get_max_threads() );
+
+#pragma omp parallel
+		{
+			const int thread_id = omp_get_thread_num();
+			Tile tile;
+
+			while ( Next( thread_id, tile ) )
+			{
+				kernel( tile, thread_id );
+			}
+		}
+	}
+
+private:
+	bool Pop( const int thread_id, Tile & tile );
+	bool Steal( const int thread_id );
+
+	/*! \struct WorkQueue
+	\brief Souvisly usek dlazdic, horni 32 bitu je begin a dolni end.
+	Doplneno na cache line, aby se fronty vlaken vzajemne nerusily.
+	*/
+	struct WorkQueue
+	{
+		std::atomic<unsigned long long> range;
+		char pad[CACHE_LINE_SIZE - sizeof( std::atomic<unsigned long long> )];
+	};
+
+	std::vector<Tile> tiles_; /*!< Dlazdice v poradi Hilbertovy krivky. */
+	WorkQueue * queues_; /*!< Fronty jednotlivych vlaken. */
+	int no_queues_; /*!< Pocet front. */
+
+	DISALLOW_COPY_AND_ASSIGN( TileScheduler );
+};
+
+/*! \fn void HilbertD2XY( const int n, const int d, int & x, int & y )
+\brief Prevede vzdalenost \a d na Hilbertove krivce do mrizky n x n na souradnice.
+\param n rozmer mrizky, mocnina dvou.
+\param d vzdalenost na krivce <0, n^2).
+*/
+void HilbertD2XY( const int n, const int d, int & x, int & y );
+
+#endif
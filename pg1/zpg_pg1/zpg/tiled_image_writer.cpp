@@ -0,0 +1,264 @@
+#include "stdafx.h"
+
+// typy a znacky TIFF 6.0
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+
+TiledImageWriter::TiledImageWriter()
+{
+	file_ = NULL;
+
+	width_ = 0;
+	height_ = 0;
+	tile_size_ = 0;
+	tiles_across_ = 0;
+	format_ = TILED_IMAGE_FLOAT32;
+	failed_ = false;
+
+	end_ = 0;
+}
+
+TiledImageWriter::~TiledImageWriter()
+{
+	if ( file_ != NULL )
+	{
+		Close();
+	}
+}
+
+static int BytesPerSample( const TiledImageFormat format )
+{
+	return ( format == TILED_IMAGE_FLOAT32 ) ? 4 : 1;
+}
+
+int TiledImageWriter::Open( const std::string & file_name, const int width, const int height, const int tile_size,
+	const TiledImageFormat format, const ResolveSettings & settings )
+{
+	if ( tile_size <= 0 || tile_size % 16 != 0 )
+	{
+		printf( "Tile size %d is not a multiple of 16.\n", tile_size );
+
+		return -1;
+	}
+
+	tiles_across_ = ( width + tile_size - 1 ) / tile_size;
+	const int tiles_down = ( height + tile_size - 1 ) / tile_size;
+	const unsigned long long tile_bytes = static_cast<unsigned long long>( SQR( tile_size ) ) * 3 * BytesPerSample( format );
+
+	if ( tile_bytes * tiles_across_ * tiles_down + 8 * static_cast<unsigned long long>( tiles_across_ ) * tiles_down + 1024 > 0xffffffffull )
+	{
+		printf( "Image %d x %d does not fit into a 4 GB TIFF, use 8-bit output.\n", width, height );
+
+		return -1;
+	}
+
+	file_ = fopen( file_name.c_str(), "wb" );
+
+	if ( file_ == NULL )
+	{
+		printf( "File %s cannot be created.\n", file_name.c_str() );
+
+		return -1;
+	}
+
+	file_name_ = file_name;
+	width_ = width;
+	height_ = height;
+	tile_size_ = tile_size;
+	format_ = format;
+	settings_ = settings;
+	failed_ = false;
+
+	offsets_.assign( tiles_across_ * tiles_down, 0 );
+
+	// hlavicka little-endian, pozice IFD se doplni v Close
+	const unsigned char header[8] = { 'I', 'I', 42, 0, 0, 0, 0, 0 };
+	fwrite( header, 1, sizeof( header ), file_ );
+	end_ = sizeof( header );
+
+	return 0;
+}
+
+int TiledImageWriter::WriteTile( const Tile & tile, const cv::Mat & pixels )
+{
+	const int ts = tile_size_;
+	const int bytes = BytesPerSample( format_ );
+
+	// prevod do RGB a doplneni okraju nulami mimo zamek
+	std::vector<unsigned char> buffer( SQR( ts ) * 3 * bytes, 0 );
+
+	for ( int y = 0; y < tile.y1 - tile.y0; ++y )
+	{
+		const int w = tile.x1 - tile.x0;
+
+		if ( format_ == TILED_IMAGE_UINT8 )
+		{
+			// stejny prevod jako PNG, vysledek je BGR, prohodi se na miste
+			unsigned char * rgb = &buffer[y * ts * 3];
+			Framebuffer::ResolveSpan( pixels.ptr<float>( y ), w, settings_, rgb );
+
+			for ( int x = 0; x < w; ++x )
+			{
+				std::swap( rgb[x * 3], rgb[x * 3 + 2] );
+			}
+
+			continue;
+		}
+
+		for ( int x = 0; x < w; ++x )
+		{
+			const cv::Vec3f & bgr = pixels.at<cv::Vec3f>( y, x );
+			float * rgb = reinterpret_cast<float *>( &buffer[0] ) + ( y * ts + x ) * 3;
+			rgb[0] = bgr[2];
+			rgb[1] = bgr[1];
+			rgb[2] = bgr[0];
+		}
+	}
+
+	const int index = ( tile.y0 / ts ) * tiles_across_ + tile.x0 / ts;
+
+	std::lock_guard<std::mutex> lock( mutex_ );
+
+	if ( fwrite( &buffer[0], 1, buffer.size(), file_ ) != buffer.size() )
+	{
+		failed_ = true;
+
+		return -1;
+	}
+
+	offsets_[index] = static_cast<unsigned int>( end_ );
+	end_ += buffer.size();
+
+	return 0;
+}
+
+static void PutShort( std::vector<unsigned char> & data, const unsigned int value )
+{
+	data.push_back( value & 0xff );
+	data.push_back( ( value >> 8 ) & 0xff );
+}
+
+static void PutLong( std::vector<unsigned char> & data, const unsigned int value )
+{
+	PutShort( data, value & 0xffff );
+	PutShort( data, value >> 16 );
+}
+
+// polozka IFD s jednou hodnotou ulozenou primo v polozce
+static void PutEntry( std::vector<unsigned char> & data, const unsigned int tag, const unsigned int type, const unsigned int count, const unsigned int value )
+{
+	PutShort( data, tag );
+	PutShort( data, type );
+	PutLong( data, count );
+
+	if ( type == TIFF_SHORT && count == 1 )
+	{
+		PutShort( data, value );
+		PutShort( data, 0 );
+	}
+	else
+	{
+		PutLong( data, value );
+	}
+}
+
+int TiledImageWriter::Close()
+{
+	if ( file_ == NULL )
+	{
+		return -1;
+	}
+
+	const unsigned int no_tiles = static_cast<unsigned int>( offsets_.size() );
+	const unsigned int tile_bytes = SQR( tile_size_ ) * 3 * BytesPerSample( format_ );
+
+	for ( unsigned int i = 0; i < no_tiles; ++i )
+	{
+		if ( offsets_[i] == 0 )
+		{
+			printf( "Tile %u of %s was never written.\n", i, file_name_.c_str() );
+			failed_ = true;
+		}
+	}
+
+	// za dlazdicemi: pole BitsPerSample, SampleFormat, TileOffsets, TileByteCounts a nakonec IFD
+	if ( end_ & 1 )
+	{
+		fputc( 0, file_ );
+		++end_;
+	}
+
+	const unsigned int bits_offset = static_cast<unsigned int>( end_ );
+	const unsigned int format_offset = bits_offset + 6;
+	const unsigned int offsets_offset = format_offset + 6;
+	const unsigned int counts_offset = offsets_offset + 4 * no_tiles;
+	const unsigned int ifd_offset = counts_offset + 4 * no_tiles;
+
+	std::vector<unsigned char> data;
+
+	for ( int c = 0; c < 3; ++c )
+	{
+		PutShort( data, 8 * BytesPerSample( format_ ) );
+	}
+
+	for ( int c = 0; c < 3; ++c )
+	{
+		PutShort( data, ( format_ == TILED_IMAGE_FLOAT32 ) ? 3 : 1 ); // IEEE float, unsigned int
+	}
+
+	for ( unsigned int i = 0; i < no_tiles; ++i )
+	{
+		PutLong( data, offsets_[i] );
+	}
+
+	for ( unsigned int i = 0; i < no_tiles; ++i )
+	{
+		PutLong( data, tile_bytes );
+	}
+
+	const int no_entries = 12;
+	PutShort( data, no_entries );
+
+	PutEntry( data, 256, TIFF_LONG, 1, width_ ); // ImageWidth
+	PutEntry( data, 257, TIFF_LONG, 1, height_ ); // ImageLength
+	PutEntry( data, 258, TIFF_SHORT, 3, bits_offset ); // BitsPerSample
+	PutEntry( data, 259, TIFF_SHORT, 1, 1 ); // Compression: zadna
+	PutEntry( data, 262, TIFF_SHORT, 1, 2 ); // PhotometricInterpretation: RGB
+	PutEntry( data, 277, TIFF_SHORT, 1, 3 ); // SamplesPerPixel
+	PutEntry( data, 284, TIFF_SHORT, 1, 1 ); // PlanarConfiguration: prokladane
+	PutEntry( data, 322, TIFF_LONG, 1, tile_size_ ); // TileWidth
+	PutEntry( data, 323, TIFF_LONG, 1, tile_size_ ); // TileLength
+	PutEntry( data, 324, TIFF_LONG, no_tiles, ( no_tiles == 1 ) ? offsets_[0] : offsets_offset ); // TileOffsets
+	PutEntry( data, 325, TIFF_LONG, no_tiles, ( no_tiles == 1 ) ? tile_bytes : counts_offset ); // TileByteCounts
+	PutEntry( data, 339, TIFF_SHORT, 3, format_offset ); // SampleFormat
+
+	PutLong( data, 0 ); // dalsi IFD neni
+
+	if ( fwrite( &data[0], 1, data.size(), file_ ) != data.size() )
+	{
+		failed_ = true;
+	}
+
+	// doplneni pozice IFD do hlavicky
+	std::vector<unsigned char> header;
+	PutLong( header, ifd_offset );
+
+	if ( fseek( file_, 4, SEEK_SET ) != 0 || fwrite( &header[0], 1, header.size(), file_ ) != header.size() )
+	{
+		failed_ = true;
+	}
+
+	fclose( file_ );
+	file_ = NULL;
+
+	offsets_.clear();
+
+	if ( failed_ )
+	{
+		printf( "Writing %s failed.\n", file_name_.c_str() );
+
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef TILED_IMAGE_WRITER_H_
+#define TILED_IMAGE_WRITER_H_
+
+/*! \enum TiledImageFormat
+\brief Format vzorku zapisovaneho obrazu.
+*/
+enum TiledImageFormat
+{
+	TILED_IMAGE_FLOAT32, /*!< 3 x 32-bit float na pixel, bez ztraty HDR. */
+	TILED_IMAGE_UINT8 /*!< 3 x 8 bitu, prevod Framebuffer::ResolveSpan stejne jako PNG (expozice, tonemapovani). */
+};
+
+/*! \class TiledImageWriter
+\brief Zapis obrazu po dlazdicich do dlazdicoveho TIFF souboru.
+
+Dlazdice se pripojuji na konec souboru v libovolnem poradi hned, jak jsou
+hotove, a zapamatuje se jen jejich pozice. Adresar TIFF (IFD) s tabulkou
+pozic dlazdic se zapise az v Close. V pameti tak nikdy neni cely obraz,
+pouze dlazdice, ktere prave renderuji vlakna.
+
+Klasicky TIFF adresuje 32 bity, soubor tedy nesmi prekrocit 4 GB
+(napr. 16K x 16K ve float32 ma 3 GB).
+*/
+class TiledImageWriter
+{
+public:
+	//! Vychozi konstruktor.
+	TiledImageWriter();
+
+	//! Destruktor, pripadne soubor dokonci.
+	~TiledImageWriter();
+
+	//! Vytvori soubor \a file_name pro obraz \a width x \a height.
+	/*!
+	\param tile_size velikost dlazdice [px], nasobek 16.
+	\param settings prevod do 8 bitu pri TILED_IMAGE_UINT8.
+	\return 0 pri uspechu, -1 pokud soubor nelze vytvorit nebo by byl prilis velky.
+	*/
+	int Open( const std::string & file_name, const int width, const int height, const int tile_size,
+		const TiledImageFormat format = TILED_IMAGE_FLOAT32, const ResolveSettings & settings = ResolveSettings() );
+
+	//! Zapise dlazdici \a tile, pixely jsou v levem hornim rohu \a pixels (CV_32FC3, BGR).
+	/*!
+	Lze volat soucasne z vice vlaken, kazdou dlazdici prave jednou.
+	*/
+	int WriteTile( const Tile & tile, const cv::Mat & pixels );
+
+	//! Zapise adresar obrazu a zavre soubor.
+	/*!
+	\return 0 pri uspechu, -1 pokud nektera dlazdice chybi nebo zapis selhal.
+	*/
+	int Close();
+
+private:
+	FILE * file_; /*!< Vystupni soubor, NULL = zavreno. */
+	std::string file_name_; /*!< Nazev souboru. */
+	std::mutex mutex_; /*!< Zamek zapisu do souboru. */
+
+	int width_; /*!< Sirka obrazu [px]. */
+	int height_; /*!< Vyska obrazu [px]. */
+	int tile_size_; /*!< Velikost dlazdice [px]. */
+	int tiles_across_; /*!< Pocet dlazdic v radku. */
+	TiledImageFormat format_; /*!< Format vzorku. */
+	ResolveSettings settings_; /*!< Prevod do 8 bitu. */
+	bool failed_; /*!< Nektery zapis selhal. */
+
+	unsigned long long end_; /*!< Aktualni konec souboru [B]. */
+	std::vector<unsigned int> offsets_; /*!< Pozice dlazdic v souboru, 0 = dosud nezapsana. */
+
+	DISALLOW_COPY_AND_ASSIGN( TiledImageWriter );
+};
+
+#endif
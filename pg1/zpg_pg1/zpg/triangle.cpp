@@ -97,3 +97,8 @@ Surface * Triangle::surface()
 {	
 	return *reinterpret_cast<Surface **>( vertices_[0].pad ); // FIX: chyb verze pro 64bit
 }
+
+void Triangle::set_surface( Surface * surface )
+{
+	*reinterpret_cast<Surface **>( &vertices_[0].pad ) = surface;
+}
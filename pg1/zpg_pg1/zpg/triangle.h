@@ -81,6 +81,12 @@ public:
 	*/
 	Surface * surface();
 
+	//! Nastavi ukazatel na sit, napr. po nacteni trojuhelniku z binarni cache.
+	/*!
+	\param surface ukazatel na sit.
+	*/
+	void set_surface( Surface * surface );
+
 protected:
 
 private:
@@ -6,17 +6,15 @@ using std::uniform_real_distribution;
 typedef mt19937                                     Engine;
 typedef uniform_real_distribution<float>            Distribution;
 
-auto uniform_generator = std::bind( Distribution( 0.0f, 1.0f ), Engine( 1 ) );
-
 float Random( const float range_min, const float range_max )
 {
-	float ksi;
+	// kazde vlakno ma vlastni generator, odpada kriticka sekce; reprodukovatelne
+	// vzorky nezavisle na poctu vlaken dava Sampler
+	static thread_local Engine engine( 1 + omp_get_thread_num() );
+	static thread_local Distribution distribution( 0.0f, 1.0f );
 
-#pragma omp critical ( random ) 
-	{
-		//ksi = static_cast<float>( rand() ) / ( RAND_MAX + 1 );
-		ksi = static_cast<float>( uniform_generator() );
-	}
+	//ksi = static_cast<float>( rand() ) / ( RAND_MAX + 1 );
+	const float ksi = distribution( engine );
 
 	return ksi * ( range_max - range_min ) + range_min;
 }
@@ -184,3 +182,42 @@ char * Trim( char * s )
 {
 	return RTrim( LTrim( s ) );
 }
+
+void SinCos4( const __m128 x, __m128 & s, __m128 & c )
+{
+	const __m128 sign_mask = _mm_set1_ps( -0.0f );
+	const __m128 pi = _mm_set1_ps( static_cast<float>( M_PI ) );
+	const __m128 half_pi = _mm_set1_ps( static_cast<float>( M_PI * 0.5 ) );
+
+	// redukce do <-pi, pi>
+	const __m128 k = _mm_cvtepi32_ps( _mm_cvtps_epi32( _mm_mul_ps( x, _mm_set1_ps( static_cast<float>( 0.5 / M_PI ) ) ) ) );
+	__m128 r = _mm_sub_ps( x, _mm_mul_ps( k, _mm_set1_ps( 6.28125f ) ) ); // 2pi rozdelene na dve casti kvuli presnosti
+	r = _mm_sub_ps( r, _mm_mul_ps( k, _mm_set1_ps( static_cast<float>( 2.0 * M_PI - 6.28125 ) ) ) );
+
+	// redukce do <-pi/2, pi/2>: sin(pi - r) = sin(r), cos(pi - r) = -cos(r)
+	const __m128 r_sign = _mm_and_ps( r, sign_mask );
+	const __m128 flip = _mm_cmpgt_ps( _mm_andnot_ps( sign_mask, r ), half_pi );
+	r = _mm_or_ps( _mm_andnot_ps( flip, r ), _mm_and_ps( flip, _mm_sub_ps( _mm_xor_ps( pi, r_sign ), r ) ) );
+	const __m128 cos_sign = _mm_and_ps( flip, sign_mask );
+
+	const __m128 r2 = _mm_mul_ps( r, r );
+
+	// Tayloruv rozvoj, na <-pi/2, pi/2> staci do x^11 resp. x^12
+	__m128 ps = _mm_set1_ps( -2.5052108e-8f );
+	ps = _mm_add_ps( _mm_mul_ps( ps, r2 ), _mm_set1_ps( 2.7557319e-6f ) );
+	ps = _mm_add_ps( _mm_mul_ps( ps, r2 ), _mm_set1_ps( -1.9841270e-4f ) );
+	ps = _mm_add_ps( _mm_mul_ps( ps, r2 ), _mm_set1_ps( 8.3333333e-3f ) );
+	ps = _mm_add_ps( _mm_mul_ps( ps, r2 ), _mm_set1_ps( -1.6666667e-1f ) );
+	ps = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( ps, r2 ), r ), r );
+
+	__m128 pc = _mm_set1_ps( 2.0876757e-9f );
+	pc = _mm_add_ps( _mm_mul_ps( pc, r2 ), _mm_set1_ps( -2.7557319e-7f ) );
+	pc = _mm_add_ps( _mm_mul_ps( pc, r2 ), _mm_set1_ps( 2.4801587e-5f ) );
+	pc = _mm_add_ps( _mm_mul_ps( pc, r2 ), _mm_set1_ps( -1.3888889e-3f ) );
+	pc = _mm_add_ps( _mm_mul_ps( pc, r2 ), _mm_set1_ps( 4.1666667e-2f ) );
+	pc = _mm_add_ps( _mm_mul_ps( pc, r2 ), _mm_set1_ps( -0.5f ) );
+	pc = _mm_add_ps( _mm_mul_ps( pc, r2 ), _mm_set1_ps( 1.0f ) );
+
+	s = ps;
+	c = _mm_xor_ps( pc, cos_sign );
+}
@@ -102,6 +102,14 @@ char * RTrim( char * s );
 */
 char * Trim( char *s );
 
+/*! \fn void SinCos4( const __m128 x, __m128 & s, __m128 & c )
+\brief Soucasne spocita sinus a kosinus ctyr uhlu (SSE, absolutni chyba pod 1e-6).
+\param x Uhly v radianech, libovolny rozsah.
+\param s Vystupni sinusy.
+\param c Vystupni kosinusy.
+*/
+void SinCos4( const __m128 x, __m128 & s, __m128 & c );
+
 
 enum GGXColor
 {
@@ -0,0 +1,104 @@
+#include "stdafx.h"
+
+Wavefront::Wavefront()
+{
+	packets_ = NULL;
+	capacity_ = 0;
+}
+
+Wavefront::~Wavefront()
+{
+	if ( packets_ != NULL )
+	{
+		_mm_free( packets_ );
+		packets_ = NULL;
+	}
+
+	capacity_ = 0;
+}
+
+std::vector<ShadingItem> & Wavefront::misses()
+{
+	return misses_;
+}
+
+std::vector<ShadingItem> & Wavefront::hits()
+{
+	return hits_;
+}
+
+void Wavefront::Trace( RTCScene scene, const Camera & camera, const Tile & tile, const int width, const int height )
+{
+	assert( ( tile.x0 % 4 == 0 ) && ( tile.y0 % 4 == 0 ) );
+
+	const int no_blocks_x = ( tile.x1 - tile.x0 + 3 ) / 4;
+	const int no_blocks_y = ( tile.y1 - tile.y0 + 3 ) / 4;
+	const int no_packets = no_blocks_x * no_blocks_y;
+
+	if ( no_packets > capacity_ )
+	{
+		if ( packets_ != NULL )
+		{
+			_mm_free( packets_ );
+		}
+
+		packets_ = static_cast<RTCRay16 *>( _mm_malloc( sizeof( RTCRay16 ) * no_packets, 64 ) );
+		capacity_ = no_packets;
+	}
+
+	// 1. generovani SoA paketu, paprsky mimo dlazdici vypneme pomoci tnear > tfar
+	for ( int p = 0; p < no_packets; ++p )
+	{
+		const int bx = tile.x0 + ( p % no_blocks_x ) * 4;
+		const int by = tile.y0 + ( p / no_blocks_x ) * 4;
+		RTCRayN * packet = reinterpret_cast<RTCRayN *>( &packets_[p] );
+
+		camera.GenerateRayPacket( bx, by, packet, 16 );
+
+		for ( int i = 0; i < 16; ++i )
+		{
+			const int x = bx + ( i & 3 );
+			const int y = by + ( i >> 2 );
+
+			if ( ( x >= tile.x1 ) || ( y >= tile.y1 ) || ( x >= width ) || ( y >= height ) )
+			{
+				RTCRayN_tnear( packet, 16, i ) = 1.0f;
+				RTCRayN_tfar( packet, 16, i ) = -1.0f;
+			}
+		}
+	}
+
+	// 2. pruchod celeho proudu akceleracni strukturou
+	RTCIntersectContext context;
+	context.flags = RTC_INTERSECT_COHERENT;
+	context.userRayExt = NULL;
+
+	rtcIntersectNM( scene, &context, reinterpret_cast<RTCRayN *>( packets_ ), 16, no_packets, sizeof( RTCRay16 ) );
+
+	// 3. kompakce - oddelime minute paprsky od zasahu
+	misses_.clear();
+	hits_.clear();
+
+	for ( int p = 0; p < no_packets; ++p )
+	{
+		const int bx = tile.x0 + ( p % no_blocks_x ) * 4;
+		const int by = tile.y0 + ( p / no_blocks_x ) * 4;
+		RTCRayN * packet = reinterpret_cast<RTCRayN *>( &packets_[p] );
+
+		for ( int i = 0; i < 16; ++i )
+		{
+			if ( RTCRayN_tnear( packet, 16, i ) > RTCRayN_tfar( packet, 16, i ) )
+			{
+				continue; // neaktivni paprsek mimo dlazdici
+			}
+
+			std::vector<ShadingItem> & queue = ( RTCRayN_geomID( packet, 16, i ) == RTC_INVALID_GEOMETRY_ID ) ? misses_ : hits_;
+
+			queue.push_back( ShadingItem() );
+			ShadingItem & item = queue.back();
+			item.x = bx + ( i & 3 );
+			item.y = by + ( i >> 2 );
+			item.ray.Unpack( packet, 16, i );
+		}
+	}
+}
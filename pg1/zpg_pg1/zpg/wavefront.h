@@ -0,0 +1,60 @@
+#ifndef WAVEFRONT_H_
+#define WAVEFRONT_H_
+
+/*! \struct ShadingItem
+\brief Primarni paprsek cekajici ve fronte na shading.
+*/
+struct ShadingItem
+{
+	int x; /*!< Sloupec pixelu [px]. */
+	int y; /*!< Radek pixelu [px]. */
+	Ray ray; /*!< Paprsek vcetne informaci o zasahu. */
+};
+
+/*! \class Wavefront
+\brief Vlnova (wavefront) faze primarnich paprsku jedne dlazdice.
+
+Misto strideni pruseciku a shadingu po pixelech se dlazdice zpracuje po
+etapach: vygeneruji se SoA pakety paprsku (RTCRay16 po blocich 4x4), cely
+proud se protne sceny jedinym volanim rtcIntersectNM, minute paprsky se
+oddeli od zasahu. Vsechny zasahy jdou do jedine fronty - shader je pro
+vsechny materialy stejny, trideni podle materialu by nesnizilo divergenci.
+
+Kazde vlakno ma vlastni instanci, buffery se mezi dlazdicemi recykluji.
+*/
+class Wavefront
+{
+public:
+	//! Vychozi konstruktor.
+	Wavefront();
+
+	//! Destruktor.
+	~Wavefront();
+
+	//! Vygeneruje a protne primarni paprsky dlazdice \a tile, oddeli zasahy od minutych.
+	/*!
+	\param scene Embree scena s povolenym RTC_INTERSECT_STREAM.
+	\param camera kamera.
+	\param tile dlazdice, levy horni roh musi byt nasobkem 4.
+	\param width sirka obrazu [px].
+	\param height vyska obrazu [px].
+	*/
+	void Trace( RTCScene scene, const Camera & camera, const Tile & tile, const int width, const int height );
+
+	//! Paprsky, ktere nic nezasahly.
+	std::vector<ShadingItem> & misses();
+
+	//! Paprsky, ktere zasahly nektery objekt sceny.
+	std::vector<ShadingItem> & hits();
+
+private:
+	RTCRay16 * packets_; /*!< Proud paketu paprsku, zarovnany na 64 bytu. */
+	int capacity_; /*!< Pocet alokovanych paketu. */
+
+	std::vector<ShadingItem> misses_; /*!< Minute paprsky. */
+	std::vector<ShadingItem> hits_; /*!< Zasahy. */
+
+	DISALLOW_COPY_AND_ASSIGN( Wavefront );
+};
+
+#endif